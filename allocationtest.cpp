@@ -0,0 +1,178 @@
+/* Heap allocations of the detection hot paths.
+
+   operator new is replaced by a counting one. For every scoring mode a
+   context is warmed on the widest image, then images of several widths
+   are detected again; no window of them may allocate. Qt containers
+   allocate through qMalloc() rather than operator new, so the growths of
+   the context buffers are checked as well. Exits with 1 if anything
+   allocated.
+*/
+
+#include <cstdlib>
+#include <new>
+#include <QImage>
+#include <QTextStream>
+#include "detectorengine.h"
+#include "detectioncontext.h"
+#include "kernelmap.h"
+
+namespace
+{
+
+long allocations = 0;
+
+QImage makeImage(int width, int height, int seed)
+{
+    // Noise over a coarse checkerboard, so that blocks differ
+    std::srand(seed);
+    QImage image(width, height, QImage::Format_RGB32);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            int gray = std::rand() % 64 + ((x / 16 + y / 24) % 2) * 120;
+            image.setPixel(x, y, qRgb(gray, gray, gray));
+        }
+    }
+    return image;
+}
+
+enum Mode { LINEAR, LINEAR_FULL, MAPPED, CASCADE, MODES };
+
+const char *modeName(int mode)
+{
+    static const char *names[] = { "linear", "linear, no early termination",
+                                   "kernel mapped", "cascade" };
+    return names[mode];
+}
+
+DetectorEngine makeEngine(int mode)
+{
+    DetectorEngine::Settings settings;
+    const DetectorVariant *variant = settings.variant;
+    settings.useLinear = mode != MAPPED;
+    settings.useEarlyTermination = mode != LINEAR_FULL;
+    settings.bound = 0.1;
+    const int mapLength = settings.useLinear ? 1 : 2 * (2 * settings.n + 1);
+    settings.weights.resize(variant->descriptorLength * mapLength);
+    std::srand(7);
+    for (int i = 0; i < settings.weights.size(); ++i)
+    {
+        settings.weights[i] = (std::rand() / double(RAND_MAX) - 0.5) * 0.2;
+    }
+    if (!settings.useLinear)
+    {
+        settings.kernelMap = DetectorEngine::buildKernelMap(variant->blockPixels,
+                                                            settings.n, settings.L);
+    }
+    settings.boundScorer.build(settings.weights.constData(), variant->winBlocksX,
+                               variant->winBlocksY,
+                               variant->blockSize * variant->blockSize,
+                               variant->bins, mapLength,
+                               kernelMapNorm(settings.n, settings.L));
+    if (mode == CASCADE)
+    {
+        // Without positives every threshold stays open
+        settings.cascade.build(settings.weights.constData(), variant->winBlocksX,
+                               variant->winBlocksY, variant->blockFeatures);
+        settings.cascade.calibrate(QVector<QVector<double> >(), settings.bound, 0.01);
+        settings.useCascade = true;
+    }
+    return DetectorEngine(settings);
+}
+
+} // namespace
+
+void *operator new(std::size_t size) throw(std::bad_alloc)
+{
+    ++allocations;
+    void *p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size) throw(std::bad_alloc)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) throw()
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) throw()
+{
+    operator delete(p);
+}
+
+int main()
+{
+    QTextStream out(stdout);
+    const int widths[] = { 640, 480, 320, 640 };
+    const int images = sizeof(widths) / sizeof(widths[0]);
+    bool ok = true;
+    for (int mode = 0; mode < MODES; ++mode)
+    {
+        const DetectorEngine engine = makeEngine(mode);
+        const int height = engine.variant()->winHeight;
+        QVector<QImage> scenes;
+        for (int i = 0; i < images; ++i)
+        {
+            scenes.push_back(makeImage(widths[i], height, i));
+        }
+
+        // Steady-state detect(): the first pass sizes the buffers and the
+        // per-stage counters of 'stats'
+        DetectionContext context;
+        DetectionStats stats;
+        QVector<int> areas;
+        for (int i = 0; i < images; ++i)
+        {
+            engine.detect(scenes[i], context, areas, &stats);
+        }
+        const qint64 warmWindows = stats.windows;
+        const int growths = context.growths();
+        const long before = allocations;
+        for (int round = 0; round < 8; ++round)
+        {
+            for (int i = 0; i < images; ++i)
+            {
+                engine.detect(scenes[i], context, areas, &stats);
+            }
+        }
+        const long detectAllocations = allocations - before;
+        const int detectGrowths = context.growths() - growths;
+
+        out << modeName(mode) << ": " << stats.windows - warmWindows << " windows, "
+            << detectAllocations << " allocations, " << detectGrowths
+            << " buffer growths\n";
+        if (detectAllocations != 0 || detectGrowths != 0)
+        {
+            ok = false;
+        }
+    }
+
+    // Single windows from the descriptor on the stack
+    const DetectorEngine engine = makeEngine(LINEAR);
+    const QVector<QVector<DetectorEngine::Cell> > cells =
+            engine.computeCells(makeImage(640, engine.variant()->winHeight, 0));
+    const int windows = cells[0].size() - engine.variant()->winWidthCell;
+    double sum = 0;
+    const long before = allocations;
+    for (int shift = 0; shift < windows; ++shift)
+    {
+        sum += engine.scoreWindow(cells, shift);
+    }
+    const long windowAllocations = allocations - before;
+    out << "descriptor: " << windows << " windows, " << windowAllocations
+        << " allocations (score sum " << sum << ")\n";
+    if (windowAllocations != 0)
+    {
+        ok = false;
+    }
+
+    out << (ok ? "PASS" : "FAIL") << '\n';
+    return ok ? 0 : 1;
+}
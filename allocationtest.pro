@@ -0,0 +1,13 @@
+# Counts heap allocations of steady-state detection, see allocationtest.cpp;
+# exits non-zero if a scored window allocates
+QT       += gui
+
+TEMPLATE = app
+TARGET = allocationtest
+CONFIG += console
+CONFIG -= app_bundle
+
+include(detector.pri)
+
+SOURCES += \
+    allocationtest.cpp
@@ -0,0 +1,81 @@
+#include "batchscore.h"
+#include <algorithm>
+
+extern "C" int dgemm_(char *transa, char *transb, int *m, int *n, int *k,
+                      double *alpha, double *a, int *lda, double *b, int *ldb,
+                      double *beta, double *c, int *ldc);
+
+void BatchScore::scoreWindows(const double *plane, int cols, int blockLength,
+                              int winBlocksX, int winBlocksY, const double *w,
+                              int windows, double *scores, double *scratch)
+{
+    if (windows <= 0)
+        return;
+
+    // Only block columns some window reaches take part in the product
+    int m = std::min(cols, windows + winBlocksX - 1);
+    int n = winBlocksX;
+    int k = blockLength;
+    int ldPlane = blockLength;
+    double one = 1.0;
+    double zero = 0.0;
+    char trans = 'T';
+    char notrans = 'N';
+    for (int y = 0; y < winBlocksY; ++y)
+    {
+        // Column-major, the plane row is a blockLength x cols matrix and
+        // the weight row a blockLength x winBlocksX one
+        double *a = const_cast<double *>(plane) + y * cols * blockLength;
+        double *b = const_cast<double *>(w) + y * winBlocksX * blockLength;
+        dgemm_(&trans, &notrans, &m, &n, &k, &one, a, &ldPlane, b, &ldPlane,
+               y == 0 ? &zero : &one, scratch, &m);
+    }
+
+    for (int s = 0; s < windows; ++s)
+    {
+        double score = 0;
+        for (int x = 0; x < winBlocksX; ++x)
+        {
+            score += scratch[s + x + x * m];
+        }
+        scores[s] = score;
+    }
+}
+
+void BatchScore::scoreWindows(const float *plane, int cols, int blockLength,
+                              int winBlocksX, int winBlocksY, const float *w,
+                              int windows, double *scores)
+{
+    std::fill(scores, scores + std::max(windows, 0), 0.0);
+    const int lastColumn = std::min(cols, windows + winBlocksX - 1);
+    for (int y = 0; y < winBlocksY; ++y)
+    {
+        const float *row = plane + y * cols * blockLength;
+        const float *rowWeights = w + y * winBlocksX * blockLength;
+        for (int column = 0; column < lastColumn; ++column)
+        {
+            const float *block = row + column * blockLength;
+            const int first = std::max(0, column - windows + 1);
+            const int last = std::min(winBlocksX - 1, column);
+            for (int x = first; x <= last; ++x)
+            {
+                // Four independent sums, a single one waits on every add
+                const float *blockWeights = rowWeights + x * blockLength;
+                float sums[4] = { 0, 0, 0, 0 };
+                int k = 0;
+                for (; k + 4 <= blockLength; k += 4)
+                {
+                    sums[0] += blockWeights[k] * block[k];
+                    sums[1] += blockWeights[k + 1] * block[k + 1];
+                    sums[2] += blockWeights[k + 2] * block[k + 2];
+                    sums[3] += blockWeights[k + 3] * block[k + 3];
+                }
+                for (; k < blockLength; ++k)
+                {
+                    sums[0] += blockWeights[k] * block[k];
+                }
+                scores[column - x] += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+            }
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef BATCHSCORE_H
+#define BATCHSCORE_H
+
+/* Dense linear scoring of every window of a block plane.
+
+   A plane is stored row-major as rows x cols blocks of 'blockLength'
+   values, and a window covers winBlocksY x winBlocksX consecutive blocks
+   with weights laid out in the same (y, x, feature) order. For each plane
+   row y the partial products of all blocks with all window-relative weight
+   slices form one matrix product
+
+       P(X, x) += sum_k plane(y, X, k) * w(y, x, k),
+
+   computed by the vendored dgemm_. The score of the window at shift s is
+   then the diagonal sum over x of P(s + x, x).
+
+   The vendored BLAS has no single-precision routines, the float overload
+   forms the same products with its own loops and adds them to the scores
+   as it goes.
+*/
+namespace BatchScore
+{
+    // Fills scores[s] for s in [0, windows), 'scratch' must hold at least
+    // (windows + winBlocksX - 1) * winBlocksX values.
+    void scoreWindows(const double *plane, int cols, int blockLength,
+                      int winBlocksX, int winBlocksY, const double *w,
+                      int windows, double *scores, double *scratch);
+    // Fills scores[s] for s in [0, windows)
+    void scoreWindows(const float *plane, int cols, int blockLength,
+                      int winBlocksX, int winBlocksY, const float *w,
+                      int windows, double *scores);
+}
+
+#endif // BATCHSCORE_H
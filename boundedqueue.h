@@ -0,0 +1,115 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <QAtomicInt>
+
+/* Fixed capacity queue for any number of producer and consumer threads,
+   without locks.
+
+   Every slot carries a sequence number telling whether it is free for
+   the push at its position or holds the value for the pop at it. A push
+   or pop claims its position with one compare-and-swap and publishes the
+   slot by storing the next sequence number. tryPush() fails on a full
+   queue and tryPop() on an empty one, waiting is up to the caller.
+*/
+template <typename T>
+class BoundedQueue
+{
+public:
+    // Capacity is rounded up to a power of two
+    explicit BoundedQueue(int capacity)
+        : m_pushPos(0), m_popPos(0)
+    {
+        int size = 1;
+        while (size < capacity)
+            size *= 2;
+        m_mask = size - 1;
+        m_slots = new Slot[size];
+        for (int i = 0; i < size; ++i)
+            m_slots[i].sequence.fetchAndStoreRelease(i);
+    }
+
+    ~BoundedQueue()
+    {
+        delete[] m_slots;
+    }
+
+    int capacity() const { return m_mask + 1; }
+
+    // Values pushed and not popped yet; exact only when no call is running
+    int size() const
+    {
+        QAtomicInt &pushPos = const_cast<QAtomicInt &>(m_pushPos);
+        QAtomicInt &popPos = const_cast<QAtomicInt &>(m_popPos);
+        return qBound(0, pushPos.fetchAndAddRelaxed(0) -
+                         popPos.fetchAndAddRelaxed(0), capacity());
+    }
+
+    bool tryPush(const T &value)
+    {
+        int pos = m_pushPos.fetchAndAddRelaxed(0);
+        Slot *slot;
+        for (;;)
+        {
+            slot = &m_slots[pos & m_mask];
+            const int diff = slot->sequence.fetchAndAddAcquire(0) - pos;
+            if (diff == 0)
+            {
+                if (m_pushPos.testAndSetRelaxed(pos, pos + 1))
+                    break;
+                pos = m_pushPos.fetchAndAddRelaxed(0);
+            } else if (diff < 0) {
+                // The slot still holds the value pushed a lap ago
+                return false;
+            } else {
+                pos = m_pushPos.fetchAndAddRelaxed(0);
+            }
+        }
+        slot->value = value;
+        slot->sequence.fetchAndStoreRelease(pos + 1);
+        return true;
+    }
+
+    bool tryPop(T *value)
+    {
+        int pos = m_popPos.fetchAndAddRelaxed(0);
+        Slot *slot;
+        for (;;)
+        {
+            slot = &m_slots[pos & m_mask];
+            const int diff = slot->sequence.fetchAndAddAcquire(0) - (pos + 1);
+            if (diff == 0)
+            {
+                if (m_popPos.testAndSetRelaxed(pos, pos + 1))
+                    break;
+                pos = m_popPos.fetchAndAddRelaxed(0);
+            } else if (diff < 0) {
+                // Nothing pushed at this position yet
+                return false;
+            } else {
+                pos = m_popPos.fetchAndAddRelaxed(0);
+            }
+        }
+        *value = slot->value;
+        // Drop the reference held by the slot before handing it back
+        slot->value = T();
+        slot->sequence.fetchAndStoreRelease(pos + m_mask + 1);
+        return true;
+    }
+
+private:
+    Q_DISABLE_COPY(BoundedQueue)
+
+    struct Slot
+    {
+        QAtomicInt sequence;
+        T value;
+    };
+
+    Slot *m_slots;
+    int m_mask;
+    QAtomicInt m_pushPos;
+    QAtomicInt m_popPos;
+};
+
+#endif // BOUNDEDQUEUE_H
@@ -0,0 +1,169 @@
+#include "boundscorer.h"
+#include <QtAlgorithms>
+#include <QtCore/qmath.h>
+#include <limits>
+
+namespace
+{
+
+struct BlockRange
+{
+    double low;
+    double high;
+    int index;
+
+    bool operator<(const BlockRange &other) const
+    {
+        double width = high - low;
+        double otherWidth = other.high - other.low;
+        return width > otherWidth || (width == otherWidth && index < other.index);
+    }
+};
+
+BlockRange blockRange(const HogFeature *w, int blockCells, int bins,
+                      int mapLength, double mapNorm)
+{
+    BlockRange range;
+    range.low = 0;
+    range.high = 0;
+    for (int k = 0; k < bins; ++k)
+    {
+        if (mapLength == 1)
+        {
+            // The bin is a distribution over the cells, or all zero
+            double low = 0;
+            double high = 0;
+            for (int c = 0; c < blockCells; ++c)
+            {
+                low = qMin(low, double(w[c * bins + k]));
+                high = qMax(high, double(w[c * bins + k]));
+            }
+            range.low += low;
+            range.high += high;
+        } else {
+            double norm = 0;
+            for (int c = 0; c < blockCells; ++c)
+            {
+                const HogFeature *weights = w + (c * bins + k) * mapLength;
+                for (int t = 0; t < mapLength; ++t)
+                {
+                    norm += double(weights[t]) * weights[t];
+                }
+            }
+            norm = qSqrt(norm * mapNorm);
+            range.low -= norm;
+            range.high += norm;
+        }
+    }
+    return range;
+}
+
+} // namespace
+
+BoundScorer::BoundScorer()
+{
+    m_blockLength = 0;
+    m_slack = 0;
+}
+
+void BoundScorer::build(const HogFeature *w, int winBlocksX, int winBlocksY,
+                        int blockCells, int bins, int mapLength,
+                        double mapNorm)
+{
+    clear();
+    const int blocks = winBlocksX * winBlocksY;
+    const int blockLength = blockCells * bins * mapLength;
+    if (blocks <= 0 || blockLength <= 0)
+        return;
+    m_blockLength = blockLength;
+
+    QVector<BlockRange> order(blocks);
+    double width = 0;
+    for (int i = 0; i < blocks; ++i)
+    {
+        order[i] = blockRange(w + i * blockLength, blockCells, bins,
+                              mapLength, mapNorm);
+        order[i].index = i;
+        width += order[i].high - order[i].low;
+    }
+    qSort(order);
+
+    m_weights.resize(blocks * blockLength);
+    HogFeature *ordered = m_weights.data();
+    for (int i = 0; i < blocks; ++i)
+    {
+        m_blockX.push_back(order[i].index % winBlocksX);
+        m_blockY.push_back(order[i].index / winBlocksX);
+        qCopy(w + order[i].index * blockLength,
+              w + (order[i].index + 1) * blockLength, ordered);
+        ordered += blockLength;
+    }
+
+    m_remaining.fill(0, blocks + 1);
+    for (int i = blocks - 1; i >= 0; --i)
+    {
+        m_remaining[i] = m_remaining[i + 1] + order[i].high;
+    }
+    // Both this and the dense scorers sum blocks in Feature precision, the
+    // error of either is within blockLength ulps of the total block range
+    m_slack = 2 * blockLength * std::numeric_limits<HogFeature>::epsilon() * width;
+}
+
+void BoundScorer::clear()
+{
+    m_blockLength = 0;
+    m_blockX.clear();
+    m_blockY.clear();
+    m_weights.clear();
+    m_remaining.clear();
+    m_slack = 0;
+}
+
+bool BoundScorer::isEmpty() const
+{
+    return m_blockX.isEmpty();
+}
+
+int BoundScorer::blocks() const
+{
+    return m_blockX.size();
+}
+
+bool BoundScorer::scoreWindow(const HogFeature *plane, int cols, int shift,
+                              double bound, double *score,
+                              int *blocks) const
+{
+    const HogFeature *window = plane + shift * m_blockLength;
+    const double reject = bound - m_slack;
+    double partial = 0;
+    for (int i = 0; i < m_blockX.size(); ++i)
+    {
+        const HogFeature *block = window +
+                (m_blockY[i] * cols + m_blockX[i]) * m_blockLength;
+        const HogFeature *w = m_weights.constData() + i * m_blockLength;
+        // Four independent sums, as the dense scorers
+        HogFeature sums[4] = { 0, 0, 0, 0 };
+        int k = 0;
+        for (; k + 4 <= m_blockLength; k += 4)
+        {
+            sums[0] += w[k] * block[k];
+            sums[1] += w[k + 1] * block[k + 1];
+            sums[2] += w[k + 2] * block[k + 2];
+            sums[3] += w[k + 3] * block[k + 3];
+        }
+        for (; k < m_blockLength; ++k)
+        {
+            sums[0] += w[k] * block[k];
+        }
+        partial += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+        if (partial + m_remaining[i + 1] < reject)
+        {
+            *score = partial;
+            *blocks = i + 1;
+            return false;
+        }
+    }
+    *score = partial;
+    *blocks = m_blockX.size();
+    return true;
+}
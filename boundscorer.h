@@ -0,0 +1,55 @@
+#ifndef BOUNDSCORER_H
+#define BOUNDSCORER_H
+
+#include <QVector>
+#include "hogcore.h"
+
+/* Lossless early termination of linear window scores.
+
+   Every bin of a block is a cell count divided by the block total of that
+   bin, so over the cells of a block each bin sums to 1 (or is all zero).
+   The dot product of a raw block with its weights therefore lies in
+   [sum_k min(0, min_c w(c, k)), sum_k max(0, max_c w(c, k))]. A kernel
+   mapped value x has norm sqrt(x * mapNorm), and Cauchy-Schwarz bounds a
+   mapped block by +-sqrt(mapNorm) * sum_k ||w(., k)||.
+
+   build() orders the blocks by the width of that interval and keeps the
+   suffix sums of the upper ends. scoreWindow() gives up on a window as
+   soon as its partial score plus everything the remaining blocks can add
+   cannot exceed the bound, so it never rejects a window the full scorer
+   would accept.
+*/
+class BoundScorer
+{
+public:
+    BoundScorer();
+
+    // 'w' holds winBlocksY x winBlocksX blocks of blockCells x bins x
+    // mapLength weights; mapNorm is the squared norm of the kernel map of
+    // 1 and is only used when mapLength > 1.
+    void build(const HogFeature *w, int winBlocksX, int winBlocksY,
+               int blockCells, int bins, int mapLength, double mapNorm);
+    void clear();
+    bool isEmpty() const;
+    int blocks() const;
+
+    // Plane layout as in DetectorEngine::computeBlockPlane(). Returns false if the
+    // window can not score above 'bound'. 'score' then holds the partial
+    // score, otherwise the full one; 'blocks' is the number of blocks read.
+    bool scoreWindow(const HogFeature *plane, int cols, int shift,
+                     double bound, double *score, int *blocks) const;
+
+private:
+    int m_blockLength;
+    // Window-relative block coordinates in scoring order
+    QVector<int> m_blockX;
+    QVector<int> m_blockY;
+    // Weights regrouped in scoring order
+    QVector<HogFeature> m_weights;
+    // Upper bound on the sum of blocks [i, blocks) of the scoring order
+    QVector<double> m_remaining;
+    // Rounding allowance between this and the dense scorers
+    double m_slack;
+};
+
+#endif // BOUNDSCORER_H
@@ -0,0 +1,183 @@
+#include "cellpyramid.h"
+#include "cellstream.h"
+#include "shiftedcells.h"
+#include <QtCore/qmath.h>
+
+namespace
+{
+
+struct Tap
+{
+    int index;
+    double weight;
+};
+
+// Source cells covered by each of 'size' destination cells, weighted by
+// overlap and normalized to sum to 1
+QVector<QVector<Tap> > resampleTaps(int sourceSize, double ratio, int size)
+{
+    QVector<QVector<Tap> > taps(size);
+    for (int d = 0; d < size; ++d)
+    {
+        double begin = d / ratio;
+        double end = qMin((d + 1) / ratio, double(sourceSize));
+        double total = 0;
+        for (int i = int(begin); i < end; ++i)
+        {
+            Tap tap;
+            tap.index = i;
+            tap.weight = qMin(end, i + 1.0) - qMax(begin, double(i));
+            if (tap.weight <= 0)
+                continue;
+            taps[d].push_back(tap);
+            total += tap.weight;
+        }
+        for (int t = 0; t < taps[d].size(); ++t)
+        {
+            taps[d][t].weight /= total;
+        }
+    }
+    return taps;
+}
+
+HogCells computeCells(const QImage &image, int cellSize, int bins)
+{
+    CellStream stream(image, cellSize, bins);
+    HogCells cells;
+    cells.reserve(stream.rows());
+    QVector<HogCell> row;
+    while (stream.readRow(row))
+    {
+        cells.push_back(row);
+    }
+    return cells;
+}
+
+} // namespace
+
+CellPyramid::CellPyramid(const QImage &image, int cellSize, int bins,
+                         int octaves, int scalesPerOctave, int minRows,
+                         int minCols, int strideX, int strideY)
+    : m_strideX(strideX),
+      m_strideY(strideY)
+{
+    QImage octaveImage = image;
+    for (int o = 0; o <= octaves && !image.isNull(); ++o)
+    {
+        if (o > 0)
+        {
+            octaveImage = octaveImage.scaled(octaveImage.width() / 2,
+                                             octaveImage.height() / 2,
+                                             Qt::IgnoreAspectRatio,
+                                             Qt::SmoothTransformation);
+        }
+        if (octaveImage.height() / cellSize < minRows ||
+                octaveImage.width() / cellSize < minCols)
+        {
+            break;
+        }
+
+        Level octave;
+        octave.scale = double(octaveImage.width()) / image.width();
+        if (strideX < cellSize || strideY < cellSize)
+        {
+            ShiftedCells shifted(octaveImage, cellSize, bins, strideX, strideY);
+            for (int y = 0; y < shifted.offsetsY(); ++y)
+            {
+                for (int x = 0; x < shifted.offsetsX(); ++x)
+                {
+                    octave.shifted.push_back(shifted.cells(x, y));
+                }
+            }
+            octave.cells = octave.shifted[0];
+        } else {
+            octave.cells = computeCells(octaveImage, cellSize, bins);
+        }
+        m_levels.push_back(octave);
+        const int octaveLevel = m_levels.size() - 1;
+
+        // The last octave gets no intermediate scales below it
+        for (int j = 1; o < octaves && j < scalesPerOctave; ++j)
+        {
+            double ratio = qPow(2.0, -double(j) / scalesPerOctave);
+            int rows = int(octaveImage.height() * ratio) / cellSize;
+            int cols = int(octaveImage.width() * ratio) / cellSize;
+            if (rows < minRows || cols < minCols)
+                break;
+
+            Level level;
+            level.scale = octave.scale * ratio;
+            level.cells = resample(m_levels[octaveLevel].cells, ratio, rows,
+                                   cols);
+            m_levels.push_back(level);
+        }
+    }
+}
+
+int CellPyramid::levels() const
+{
+    return m_levels.size();
+}
+
+const CellPyramid::Level &CellPyramid::level(int i) const
+{
+    return m_levels[i];
+}
+
+int CellPyramid::strideX() const
+{
+    return m_strideX;
+}
+
+int CellPyramid::strideY() const
+{
+    return m_strideY;
+}
+
+HogCells CellPyramid::resample(const HogCells &cells, double ratio, int rows,
+                               int cols)
+{
+    if (cells.isEmpty() || rows <= 0 || cols <= 0)
+        return HogCells();
+    const int bins = cells[0].isEmpty() ? 0 : cells[0][0].size();
+    QVector<QVector<Tap> > rowTaps = resampleTaps(cells.size(), ratio, rows);
+    QVector<QVector<Tap> > colTaps = resampleTaps(cells[0].size(), ratio, cols);
+
+    // Columns first, then rows; averaging keeps cellSize^2 counts per cell
+    HogCells narrow(cells.size(), QVector<HogCell>(cols, HogCell(bins, 0)));
+    for (int y = 0; y < cells.size(); ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+        {
+            HogFeature *out = narrow[y][x].data();
+            for (int t = 0; t < colTaps[x].size(); ++t)
+            {
+                const HogFeature *in = cells[y][colTaps[x][t].index].constData();
+                const double weight = colTaps[x][t].weight;
+                for (int k = 0; k < bins; ++k)
+                {
+                    out[k] += HogFeature(weight * in[k]);
+                }
+            }
+        }
+    }
+
+    HogCells resampled(rows, QVector<HogCell>(cols, HogCell(bins, 0)));
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int t = 0; t < rowTaps[y].size(); ++t)
+        {
+            const QVector<HogCell> &in = narrow[rowTaps[y][t].index];
+            const double weight = rowTaps[y][t].weight;
+            for (int x = 0; x < cols; ++x)
+            {
+                HogFeature *out = resampled[y][x].data();
+                for (int k = 0; k < bins; ++k)
+                {
+                    out[k] += HogFeature(weight * in[x][k]);
+                }
+            }
+        }
+    }
+    return resampled;
+}
@@ -0,0 +1,58 @@
+#ifndef CELLPYRAMID_H
+#define CELLPYRAMID_H
+
+#include <QImage>
+#include <QVector>
+#include "hogcore.h"
+
+/* Cell histograms of an image at a range of scales.
+
+   Only octave levels (scale 1, 1/2, 1/4, ...) are computed from pixels,
+   each from the previous octave image halved. The scales in between are
+   approximated by resampling the cell grid of the octave above them, so a
+   level costs O(cells) instead of O(pixels). Block features are ratios of
+   cell counts, so the power law correction of the fast feature pyramid
+   cancels out and resampled histograms are only rescaled to keep
+   cellSize^2 counts per cell.
+
+   Octave levels can also be scanned at sub-cell pixel strides: their
+   grids for every cell origin (x * strideX, y * strideY) come from one
+   ShiftedCells pass over the octave image.
+*/
+class CellPyramid
+{
+public:
+    struct Level
+    {
+        // Level size divided by the image size
+        double scale;
+        HogCells cells;
+        // Octave levels with sub-cell strides only: grid of the cells
+        // starting at pixel (x * strideX, y * strideY) at index
+        // y * (cellSize / strideX) + x, 'cells' is the first one
+        QVector<HogCells> shifted;
+    };
+
+    // Levels smaller than minRows x minCols cells are left out. Strides
+    // must divide cellSize, cellSize itself meaning none.
+    CellPyramid(const QImage &image, int cellSize, int bins, int octaves,
+                int scalesPerOctave, int minRows, int minCols, int strideX,
+                int strideY);
+
+    int levels() const;
+    const Level &level(int i) const;
+    int strideX() const;
+    int strideY() const;
+
+    // Area-weighted resampling of a cell grid by 'ratio' (<= 1) to
+    // rows x cols cells
+    static HogCells resample(const HogCells &cells, double ratio, int rows,
+                             int cols);
+
+private:
+    QVector<Level> m_levels;
+    int m_strideX;
+    int m_strideY;
+};
+
+#endif // CELLPYRAMID_H
@@ -0,0 +1,139 @@
+#include "cellstream.h"
+#include "gradient.h"
+
+CellStream::CellStream(const QImage &image, int cellSize, int bins)
+    : m_reader(image),
+      m_cellWidth(cellSize),
+      m_cellHeight(cellSize),
+      m_bins(bins)
+{
+    start();
+}
+
+CellStream::CellStream(const QImage &image, int cellWidth, int cellHeight,
+                       int bins)
+    : m_reader(image),
+      m_cellWidth(cellWidth),
+      m_cellHeight(cellHeight),
+      m_bins(bins)
+{
+    start();
+}
+
+void CellStream::reset(const QImage &image)
+{
+    m_reader = Grayscale::Reader(image);
+    start();
+}
+
+void CellStream::start()
+{
+    // Buffers only ever grow, so a stream reset for images no wider than
+    // the widest one so far allocates nothing
+    m_width = m_reader.width();
+    m_height = m_reader.height();
+    m_nextRow = 0;
+    m_lastGrayRow = -1;
+    m_ring[0] = m_ring[1] = m_ring[2] = NULL;
+    const int width = qMax(m_width, 0);
+    if (m_ringStorage.size() < 3 * width)
+    {
+        m_ringStorage.resize(3 * width);
+    }
+    if (m_gradX.size() < width)
+    {
+        m_gradX.resize(width);
+        m_gradY.resize(width);
+        m_orientation.resize(width);
+    }
+    if (m_histograms.size() < cols())
+    {
+        m_histograms.resize(cols());
+    }
+}
+
+int CellStream::rows() const
+{
+    return m_height / m_cellHeight;
+}
+
+int CellStream::cols() const
+{
+    return m_width / m_cellWidth;
+}
+
+const uchar *CellStream::grayRow(int y)
+{
+    // Rows are requested in increasing order, at most two behind the last
+    while (m_lastGrayRow < y)
+    {
+        ++m_lastGrayRow;
+        int slot = m_lastGrayRow % 3;
+        m_ring[slot] = m_reader.row(m_lastGrayRow,
+                                    m_ringStorage.data() + slot * m_width);
+    }
+    return m_ring[y % 3];
+}
+
+bool CellStream::readRow(QVector<HogCell> &row)
+{
+    if (m_nextRow >= rows())
+        return false;
+
+    const int cols = this->cols();
+    row.fill(HogCell(m_bins, 0), cols);
+    for (int j = 0; j < cols; ++j)
+    {
+        m_histograms[j] = row[j].data();
+    }
+    accumulateRow(m_histograms.data());
+    return true;
+}
+
+bool CellStream::readRow(HogFeature *row)
+{
+    if (m_nextRow >= rows())
+        return false;
+
+    const int cols = this->cols();
+    qFill(row, row + cols * m_bins, HogFeature(0));
+    for (int j = 0; j < cols; ++j)
+    {
+        m_histograms[j] = row + j * m_bins;
+    }
+    accumulateRow(m_histograms.data());
+    return true;
+}
+
+void CellStream::accumulateRow(HogFeature **histograms)
+{
+    const int cols = this->cols();
+    for (int dy = 0; dy < m_cellHeight; ++dy)
+    {
+        int y = m_nextRow * m_cellHeight + dy;
+        if (y == 0 || y == m_height - 1)
+        {
+            for (int j = 0; j < cols; ++j)
+            {
+                histograms[j][0] += m_cellWidth;
+            }
+            continue;
+        }
+
+        Gradient::sobelRow(grayRow(y - 1), grayRow(y), grayRow(y + 1), m_width,
+                           m_gradX.data(), m_gradY.data());
+        Gradient::orientationRow(m_gradX.constData(), m_gradY.constData(),
+                                 m_width, m_orientation.data());
+        const uchar *bins = m_orientation.constData();
+        for (int j = 0; j < cols; ++j)
+        {
+            HogFeature *histogram = histograms[j];
+            for (int dx = 0; dx < m_cellWidth; ++dx)
+            {
+                ++histogram[*bins++];
+            }
+        }
+    }
+
+    ++m_nextRow;
+}
@@ -0,0 +1,60 @@
+#ifndef CELLSTREAM_H
+#define CELLSTREAM_H
+
+#include <QImage>
+#include <QVector>
+#include "grayscale.h"
+#include "hogcore.h"
+
+/* Computes HOG cell histograms one cell row at a time.
+
+   Only the three gray rows the Sobel operator needs are kept, in a ring
+   buffer, and every pixel's orientation bin goes straight into its cell,
+   so memory stays O(width) whatever the image height. Finished cell rows
+   are handed out by readRow() as soon as their last pixel row is read.
+
+   Border pixels of the image have no gradient and count in bin 0.
+   Cells may be rectangular, cellWidth x cellHeight pixels.
+*/
+class CellStream
+{
+public:
+    CellStream(const QImage &image, int cellSize, int bins);
+    CellStream(const QImage &image, int cellWidth, int cellHeight, int bins);
+
+    int rows() const;
+    int cols() const;
+
+    // Fills 'row' with the next cell row; false when all rows were read
+    bool readRow(QVector<HogCell> &row);
+    // Same, into cols() x bins contiguous values
+    bool readRow(HogFeature *row);
+
+    // Restarts the stream on another image, keeping the cell size and the
+    // buffers
+    void reset(const QImage &image);
+
+private:
+    void start();
+    const uchar *grayRow(int y);
+    void accumulateRow(HogFeature **histograms);
+
+    Grayscale::Reader m_reader;
+    int m_cellWidth;
+    int m_cellHeight;
+    int m_bins;
+    int m_width;
+    int m_height;
+    int m_nextRow;
+
+    int m_lastGrayRow;
+    const uchar *m_ring[3];
+    QVector<uchar> m_ringStorage;
+    QVector<short> m_gradX;
+    QVector<short> m_gradY;
+    QVector<uchar> m_orientation;
+    // Histogram of every cell of the row being accumulated
+    QVector<HogFeature *> m_histograms;
+};
+
+#endif // CELLSTREAM_H
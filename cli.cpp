@@ -0,0 +1,857 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QFileInfo>
+#include <QLocalSocket>
+#include <QThread>
+#include <cstdio>
+#include <cstring>
+#include "model.h"
+#include "grayscale.h"
+#include "detectioncontext.h"
+#include "detectionserver.h"
+
+/* Console front end of Model for batch runs and scripted benchmarks.
+
+   Progress and diagnostics of Model go to stderr through qDebug(); stdout
+   only gets one summary line per run, a JSON object with the command,
+   its settings, wall time and the results of the command.
+
+   'serve' keeps a loaded model in a DetectionServer until the process is
+   stopped; 'load' is its load generator, measuring request latencies the
+   way a client sees them. 'scores' and 'compare' check a single precision
+   build against a double precision one on the same images and model.
+*/
+
+namespace
+{
+
+const char usage[] =
+    "Usage: detectorcli <command> [options]\n"
+    "\n"
+    "Commands:\n"
+    "  train      sample <dir>/positive and <dir>/negative, train, save --model\n"
+    "  bootstrap  train, then retrain on false detections, save --model\n"
+    "  classify   detect on every image of --dir, write --locations\n"
+    "  evaluate   compare --locations with the ground truth --truth\n"
+    "  scan       detect on --image, save it with the windows drawn to --output\n"
+    "  serve      load --model and answer detection requests on --socket\n"
+    "  load       send --requests detection requests of --image to --socket\n"
+    "  scores     detect on every image of --dir, write detections and scores\n"
+    "             to --scores\n"
+    "  compare    compare the --scores of two builds with --reference\n"
+    "\n"
+    "Options:\n"
+    "  --dir <path>          image directory\n"
+    "  --model <file>        model file\n"
+    "  --locations <file>    detected locations\n"
+    "  --truth <file>        ground truth locations\n"
+    "  --image <file>        image to scan\n"
+    "  --output <file>       where to save the scanned image\n"
+    "  --variant <name>      window geometry: 80x200 (default) or 64x128\n"
+    "  --kernel              additive kernel map instead of a linear SVM\n"
+    "  --bound <value>       detection threshold\n"
+    "  --cascade             soft cascade over the window blocks\n"
+    "  --octaves <n>         pyramid octaves below the image scale (default 0)\n"
+    "  --scales <n>          pyramid levels per octave (default 4)\n"
+    "  --grid-scan           scan every window row, not only the top one\n"
+    "  --no-early-termination\n"
+    "                        score every window in full, even once the bound\n"
+    "                        decides it\n"
+    "  --threads <n>         detection workers, 0 for one per core (default 1)\n"
+    "  --decoders <n>        threads decoding ahead of the workers (default 0)\n"
+    "  --batch <n>           images per worker batch or pipeline queue (default 4)\n"
+    "                        or requests in flight per load client (default 1)\n"
+    "  --socket <name>       local socket of serve and load (default detector)\n"
+    "  --gray                load sends the gray pixels of --image, not its path\n"
+    "  --clients <n>         concurrent load clients (default 1)\n"
+    "  --requests <n>        requests per load client (default 1000)\n"
+    "  --scores <file>       detections with their scores\n"
+    "  --reference <file>    scores to compare --scores with\n"
+    "  --tolerance <value>   largest score deviation compare accepts (default 1e-4)\n";
+
+enum
+{
+    CONNECT_MSECS = 5000,
+    REPLY_MSECS = 30000
+};
+
+enum Command { TRAIN, BOOTSTRAP, CLASSIFY, EVALUATE, SCAN, SERVE, LOAD, SCORES, COMPARE };
+
+struct Options
+{
+    Options()
+        : socket("detector"), threads(1), decoders(0), batch(0), clients(1),
+          requests(1000), octaves(0), scalesPerOctave(4), useGridScan(false),
+          useKernel(false), bound(0.0), hasBound(false),
+          useCascade(false), useEarlyTermination(true),
+          useGray(false), tolerance(1e-4)
+    {
+    }
+
+    Command command;
+    QString commandName;
+    QString dir;
+    QString model;
+    QString locations;
+    QString truth;
+    QString image;
+    QString output;
+    QString variant;
+    QString socket;
+    QString scores;
+    QString reference;
+    int threads;
+    int decoders;
+    int batch;
+    int clients;
+    int requests;
+    int octaves;
+    int scalesPerOctave;
+    bool useGridScan;
+    bool useKernel;
+    double bound;
+    bool hasBound;
+    bool useCascade;
+    bool useEarlyTermination;
+    bool useGray;
+    double tolerance;
+};
+
+bool parseCommand(const QString &name, Command *command)
+{
+    const char *names[] = { "train", "bootstrap", "classify", "evaluate", "scan", "serve",
+                            "load", "scores", "compare" };
+    for (int i = 0; i < int(sizeof(names) / sizeof(names[0])); ++i)
+    {
+        if (name == names[i])
+        {
+            *command = Command(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseInt(const QString &text, int *value)
+{
+    bool ok = false;
+    *value = text.toInt(&ok);
+    return ok && *value >= 0;
+}
+
+// Fills 'options' from the arguments after the program name, 'error' tells
+// what is wrong otherwise
+bool parseArguments(const QStringList &args, Options *options, QString *error)
+{
+    if (args.isEmpty() || !parseCommand(args[0], &options->command))
+    {
+        *error = args.isEmpty() ? "no command" : "unknown command " + args[0];
+        return false;
+    }
+    options->commandName = args[0];
+
+    for (int i = 1; i < args.size(); ++i)
+    {
+        const QString &arg = args[i];
+        if (arg == "--kernel")
+        {
+            options->useKernel = true;
+            continue;
+        }
+        if (arg == "--cascade")
+        {
+            options->useCascade = true;
+            continue;
+        }
+        if (arg == "--grid-scan")
+        {
+            options->useGridScan = true;
+            continue;
+        }
+        if (arg == "--no-early-termination")
+        {
+            options->useEarlyTermination = false;
+            continue;
+        }
+        if (arg == "--gray")
+        {
+            options->useGray = true;
+            continue;
+        }
+
+        // Everything else takes a value
+        if (i + 1 >= args.size())
+        {
+            *error = "missing value of " + arg;
+            return false;
+        }
+        const QString value = args[++i];
+        bool ok = true;
+        if (arg == "--dir")
+        {
+            options->dir = value;
+        } else if (arg == "--model") {
+            options->model = value;
+        } else if (arg == "--locations") {
+            options->locations = value;
+        } else if (arg == "--truth") {
+            options->truth = value;
+        } else if (arg == "--image") {
+            options->image = value;
+        } else if (arg == "--output") {
+            options->output = value;
+        } else if (arg == "--variant") {
+            options->variant = value;
+        } else if (arg == "--socket") {
+            options->socket = value;
+        } else if (arg == "--scores") {
+            options->scores = value;
+        } else if (arg == "--reference") {
+            options->reference = value;
+        } else if (arg == "--tolerance") {
+            options->tolerance = value.toDouble(&ok);
+            ok = ok && options->tolerance >= 0;
+        } else if (arg == "--bound") {
+            options->bound = value.toDouble(&ok);
+            options->hasBound = true;
+        } else if (arg == "--threads") {
+            ok = parseInt(value, &options->threads);
+        } else if (arg == "--decoders") {
+            ok = parseInt(value, &options->decoders);
+        } else if (arg == "--batch") {
+            ok = parseInt(value, &options->batch) && options->batch > 0;
+        } else if (arg == "--clients") {
+            ok = parseInt(value, &options->clients) && options->clients > 0;
+        } else if (arg == "--requests") {
+            ok = parseInt(value, &options->requests) && options->requests > 0;
+        } else if (arg == "--octaves") {
+            ok = parseInt(value, &options->octaves);
+        } else if (arg == "--scales") {
+            ok = parseInt(value, &options->scalesPerOctave) && options->scalesPerOctave > 0;
+        } else {
+            *error = "unknown option " + arg;
+            return false;
+        }
+        if (!ok)
+        {
+            *error = "bad value of " + arg + ": " + value;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Name of the first option 'command' needs and 'options' lacks, empty if
+// none is missing
+QString missingOption(const Options &options)
+{
+    switch (options.command)
+    {
+    case TRAIN:
+    case BOOTSTRAP:
+        if (options.dir.isEmpty())
+            return "--dir";
+        if (options.model.isEmpty())
+            return "--model";
+        break;
+    case CLASSIFY:
+        if (options.dir.isEmpty())
+            return "--dir";
+        if (options.model.isEmpty())
+            return "--model";
+        if (options.locations.isEmpty())
+            return "--locations";
+        break;
+    case EVALUATE:
+        if (options.locations.isEmpty())
+            return "--locations";
+        if (options.truth.isEmpty())
+            return "--truth";
+        break;
+    case SCAN:
+        if (options.model.isEmpty())
+            return "--model";
+        if (options.image.isEmpty())
+            return "--image";
+        if (options.output.isEmpty())
+            return "--output";
+        break;
+    case SERVE:
+        if (options.model.isEmpty())
+            return "--model";
+        break;
+    case LOAD:
+        if (options.image.isEmpty())
+            return "--image";
+        break;
+    case SCORES:
+        if (options.dir.isEmpty())
+            return "--dir";
+        if (options.model.isEmpty())
+            return "--model";
+        if (options.scores.isEmpty())
+            return "--scores";
+        break;
+    case COMPARE:
+        if (options.scores.isEmpty())
+            return "--scores";
+        if (options.reference.isEmpty())
+            return "--reference";
+        break;
+    }
+    return QString();
+}
+
+QString jsonString(const QString &value)
+{
+    QString escaped = value;
+    escaped.replace('\\', "\\\\").replace('"', "\\\"");
+    return '"' + escaped + '"';
+}
+
+// Key and value pairs of the summary line, values already in JSON
+class Summary
+{
+public:
+    void add(const QString &key, const QString &json)
+    {
+        m_fields << jsonString(key) + ':' + json;
+    }
+    void add(const QString &key, qint64 value)
+    {
+        add(key, QString::number(value));
+    }
+    void add(const QString &key, double value)
+    {
+        add(key, QString::number(value, 'g', 10));
+    }
+    void add(const QString &key, bool value)
+    {
+        add(key, QString(value ? "true" : "false"));
+    }
+
+    QString toString() const
+    {
+        return '{' + m_fields.join(",") + '}';
+    }
+
+private:
+    QStringList m_fields;
+};
+
+/* One client of the load generator: its own connection, sending the same
+   request over and over with up to 'inFlight' of them unanswered. Blocking
+   socket calls, so it needs no event loop.
+*/
+class LoadClient : public QThread
+{
+public:
+    LoadClient(const QString &socketName, const DetectionProtocol::Request &request,
+               int requests, int inFlight)
+        : m_socketName(socketName),
+          m_request(request),
+          m_requests(requests),
+          m_inFlight(inFlight),
+          m_errors(0),
+          m_serverUsecs(0),
+          m_detections(0)
+    {
+    }
+
+    // Microseconds from sending each answered request to its reply
+    const QVector<qint64> &latencies() const { return m_latencies; }
+    // Replies other than OK
+    int errors() const { return m_errors; }
+    // Sums over the OK replies
+    qint64 serverUsecs() const { return m_serverUsecs; }
+    qint64 detections() const { return m_detections; }
+    // Why the client stopped early, empty if it did not
+    QString failure() const { return m_failure; }
+
+protected:
+    void run()
+    {
+        QLocalSocket socket;
+        socket.connectToServer(m_socketName);
+        if (!socket.waitForConnected(CONNECT_MSECS))
+        {
+            m_failure = socket.errorString();
+            return;
+        }
+
+        QElapsedTimer clock;
+        clock.start();
+        QVector<qint64> sentUsecs(m_requests);
+        int sent = 0;
+        int received = 0;
+        while (received < m_requests)
+        {
+            for (; sent < m_requests && sent - received < m_inFlight; ++sent)
+            {
+                m_request.id = sent;
+                sentUsecs[sent] = clock.nsecsElapsed() / 1000;
+                DetectionProtocol::writeFrame(&socket, DetectionProtocol::encode(m_request));
+            }
+            socket.flush();
+
+            QByteArray payload;
+            bool error = false;
+            if (!DetectionProtocol::readFrame(&socket, &payload, &error))
+            {
+                if (error || !socket.waitForReadyRead(REPLY_MSECS))
+                {
+                    m_failure = error ? QString("oversized reply") : socket.errorString();
+                    return;
+                }
+                continue;
+            }
+            DetectionProtocol::Reply reply;
+            if (!DetectionProtocol::decode(payload, &reply) ||
+                    reply.id >= quint32(sent))
+            {
+                m_failure = "malformed reply";
+                return;
+            }
+            ++received;
+            m_latencies.push_back(clock.nsecsElapsed() / 1000 - sentUsecs[reply.id]);
+            if (reply.status != DetectionProtocol::OK)
+            {
+                ++m_errors;
+                continue;
+            }
+            m_serverUsecs += reply.serverUsecs;
+            m_detections += reply.detections.size();
+        }
+        socket.disconnectFromServer();
+    }
+
+private:
+    QString m_socketName;
+    DetectionProtocol::Request m_request;
+    int m_requests;
+    int m_inFlight;
+    QVector<qint64> m_latencies;
+    int m_errors;
+    qint64 m_serverUsecs;
+    qint64 m_detections;
+    QString m_failure;
+};
+
+// Value below which 'fraction' of the sorted 'values' lie
+qint64 percentile(const QVector<qint64> &values, double fraction)
+{
+    if (values.isEmpty())
+        return 0;
+    return values[qMin(int(fraction * values.size()), values.size() - 1)];
+}
+
+// The load command: 'clients' connections sending 'requests' each
+bool runLoad(const Options &options, Summary *summary, QString *error)
+{
+    DetectionProtocol::Request request;
+    if (options.useGray)
+    {
+        const QImage image(options.image);
+        if (image.isNull())
+        {
+            *error = "can not read image " + options.image;
+            return false;
+        }
+        const Grayscale::Reader reader(image);
+        request.kind = DetectionProtocol::GRAY_IMAGE;
+        request.width = reader.width();
+        request.height = reader.height();
+        request.pixels.resize(request.width * request.height);
+        uchar *pixels = reinterpret_cast<uchar *>(request.pixels.data());
+        for (int y = 0; y < request.height; ++y, pixels += request.width)
+        {
+            const uchar *row = reader.row(y, pixels);
+            if (row != pixels)
+                memcpy(pixels, row, request.width);
+        }
+    } else {
+        // The server may run in another directory
+        request.path = QFileInfo(options.image).absoluteFilePath();
+    }
+
+    const int inFlight = options.batch > 0 ? options.batch : 1;
+    QVector<LoadClient *> clients(options.clients);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < clients.size(); ++i)
+    {
+        clients[i] = new LoadClient(options.socket, request, options.requests, inFlight);
+        clients[i]->start();
+    }
+    QVector<qint64> latencies;
+    qint64 errors = 0;
+    qint64 serverUsecs = 0;
+    qint64 detections = 0;
+    for (int i = 0; i < clients.size(); ++i)
+    {
+        clients[i]->wait();
+        latencies += clients[i]->latencies();
+        errors += clients[i]->errors();
+        serverUsecs += clients[i]->serverUsecs();
+        detections += clients[i]->detections();
+        if (error->isEmpty() && !clients[i]->failure().isEmpty())
+            *error = "client " + QString::number(i) + ": " + clients[i]->failure();
+    }
+    const qint64 msecs = qMax(timer.elapsed(), qint64(1));
+    qDeleteAll(clients);
+    qSort(latencies);
+
+    const qint64 answered = qMax(latencies.size() - errors, qint64(1));
+    summary->add("clients", qint64(options.clients));
+    summary->add("in_flight", qint64(inFlight));
+    summary->add("gray", options.useGray);
+    summary->add("requests", qint64(latencies.size()));
+    summary->add("errors", errors);
+    summary->add("wall_ms", msecs);
+    summary->add("requests_per_second", latencies.size() * 1000.0 / msecs);
+    summary->add("latency_p50_us", percentile(latencies, 0.5));
+    summary->add("latency_p90_us", percentile(latencies, 0.9));
+    summary->add("latency_p99_us", percentile(latencies, 0.99));
+    summary->add("latency_max_us", latencies.isEmpty() ? qint64(0) : latencies.last());
+    summary->add("server_us_mean", double(serverUsecs) / answered);
+    summary->add("detections_mean", double(detections) / answered);
+    return error->isEmpty();
+}
+
+/* The scores command: every detection of every image of the directory
+   with its score at full precision, one "<image> <x> <y> <width> <height>
+   <score>" line each. Files written by the single and the double
+   precision build are then compared by compareScores().
+*/
+bool writeScores(const Options &options, Model &model, Summary *summary,
+                 QString *error)
+{
+    QFile file(options.scores);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        *error = "can not write " + options.scores;
+        return false;
+    }
+    QTextStream out(&file);
+
+    QStringList filters;
+    filters << "*.png" << "*.jpg" << "*.bmp" << "*.jpeg";
+    QDir dir(options.dir);
+    dir.setNameFilters(filters);
+    const QStringList images = dir.entryList(QDir::NoFilter, QDir::Name);
+
+    const DetectorEngine &detector = model.engine();
+    DetectionContext context;
+    DetectionStats stats;
+    QVector<Detection> detections;
+    qint64 detectNsecs = 0;
+    qint64 detected = 0;
+    QElapsedTimer timer;
+    for (int i = 0; i < images.size(); ++i)
+    {
+        const QImage image(options.dir + images.at(i));
+        if (image.isNull())
+        {
+            *error = "can not read image " + images.at(i);
+            return false;
+        }
+        // Decoding is the same in both builds, only detection is timed
+        timer.start();
+        detector.detectWindows(image, context, detections, &stats);
+        detectNsecs += timer.nsecsElapsed();
+        detected += detections.size();
+        for (int j = 0; j < detections.size(); ++j)
+        {
+            const QRect &box = detections[j].box;
+            out << images.at(i) << ' ' << box.x() << ' ' << box.y() << ' ' <<
+                   box.width() << ' ' << box.height() << ' ' <<
+                   QString::number(detections[j].score, 'g', 17) << '\n';
+        }
+    }
+    out.flush();
+    file.close();
+
+    const double detectMsecs = qMax(detectNsecs, qint64(1)) / 1e6;
+    summary->add("images", qint64(images.size()));
+    summary->add("detections", detected);
+    summary->add("windows", stats.windows);
+    summary->add("detect_ms", detectMsecs);
+    summary->add("windows_per_second", stats.windows * 1000.0 / detectMsecs);
+    if (stats.boundWindows)
+    {
+        summary->add("bound_windows", stats.boundWindows);
+        summary->add("bound_blocks_per_window", double(stats.boundBlocks) / stats.boundWindows);
+    }
+    return true;
+}
+
+// Scores of a scores file by "<image> <x> <y> <width> <height>"
+bool readScores(const QString &fileName, QMap<QString, double> *scores)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QTextStream in(&file);
+    for (;;)
+    {
+        QString image;
+        int x, y, width, height;
+        double score;
+        in >> image >> x >> y >> width >> height >> score;
+        if (in.status() != QTextStream::Ok)
+            break;
+        const QString box = image + ' ' + QString::number(x) + ' ' +
+                QString::number(y) + ' ' + QString::number(width) + ' ' +
+                QString::number(height);
+        scores->insert(box, score);
+    }
+    return true;
+}
+
+// The cascade is calibrated on data saved with the model, one trained
+// before it was kept can not reject windows early
+bool loadModel(const Options &options, Model &model, QString *error)
+{
+    if (!model.loadModel())
+    {
+        *error = "can not load model file " + options.model;
+        return false;
+    }
+    if (options.useCascade && !model.canCalibrateCascade())
+    {
+        *error = "no cascade calibration data next to " + options.model +
+                 ", train the model again";
+        return false;
+    }
+    return true;
+}
+
+/* The compare command. Detections in both files are matched by image and
+   box; their largest score difference has to stay within the tolerance.
+   Detections only one file has are windows whose score crossed the bound
+   and are counted, not failed on.
+*/
+bool compareScores(const Options &options, Summary *summary, QString *error)
+{
+    QMap<QString, double> scores;
+    QMap<QString, double> reference;
+    if (!readScores(options.scores, &scores) ||
+            !readScores(options.reference, &reference))
+    {
+        *error = "can not read " + options.scores + " or " + options.reference;
+        return false;
+    }
+
+    qint64 matched = 0;
+    qint64 added = 0;
+    double maxDeviation = 0;
+    double sumDeviation = 0;
+    for (QMap<QString, double>::const_iterator i = scores.constBegin();
+         i != scores.constEnd(); ++i)
+    {
+        QMap<QString, double>::const_iterator other = reference.constFind(i.key());
+        if (other == reference.constEnd())
+        {
+            ++added;
+            continue;
+        }
+        const double deviation = qAbs(i.value() - other.value());
+        maxDeviation = qMax(maxDeviation, deviation);
+        sumDeviation += deviation;
+        ++matched;
+    }
+
+    summary->add("reference_detections", qint64(reference.size()));
+    summary->add("detections", qint64(scores.size()));
+    summary->add("matched", matched);
+    summary->add("added", added);
+    summary->add("removed", qint64(reference.size()) - matched);
+    summary->add("max_score_deviation", maxDeviation);
+    summary->add("mean_score_deviation", matched ? sumDeviation / matched : 0.0);
+    summary->add("tolerance", options.tolerance);
+    if (maxDeviation > options.tolerance)
+    {
+        *error = "scores deviate by " + QString::number(maxDeviation) +
+                 ", more than " + QString::number(options.tolerance);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream err(stderr);
+    QTextStream out(stdout);
+
+    Options options;
+    QString error;
+    QStringList args = app.arguments().mid(1);
+    if (args.isEmpty() || args[0] == "--help" || args[0] == "-h")
+    {
+        out << usage;
+        return args.isEmpty() ? 2 : 0;
+    }
+    if (!parseArguments(args, &options, &error))
+    {
+        err << "detectorcli: " << error << "\n\n" << usage;
+        return 2;
+    }
+    const QString missing = missingOption(options);
+    if (!missing.isEmpty())
+    {
+        err << "detectorcli: " << options.commandName << " needs " << missing << '\n';
+        return 2;
+    }
+
+    // Same paths as the view, which always ends the directory with a separator
+    if (!options.dir.isEmpty() && !options.dir.endsWith('/') &&
+            !options.dir.endsWith(QDir::separator()))
+    {
+        options.dir += '/';
+    }
+
+    Model model;
+    model.setDirName(options.dir);
+    model.setModelFileName(options.model);
+    model.setUserLocationFileName(options.locations);
+    model.setTrueLocationFileName(options.truth);
+    model.setKernel(!options.useKernel);
+    if (options.hasBound)
+        model.setBound(options.bound);
+    if (!options.variant.isEmpty() && !model.setVariant(options.variant))
+    {
+        err << "detectorcli: unknown variant " << options.variant << '\n';
+        return 2;
+    }
+    model.setCascade(options.useCascade);
+    model.setEarlyTermination(options.useEarlyTermination);
+    model.setPyramid(options.octaves, options.scalesPerOctave);
+    model.setGridScan(options.useGridScan);
+    model.setThreads(options.threads);
+    model.setDecoders(options.decoders);
+    if (options.batch > 0)
+        model.setBatchSize(options.batch);
+
+    Summary summary;
+    summary.add("command", jsonString(options.commandName));
+    summary.add("precision", jsonString(sizeof(Model::Feature) == sizeof(float)
+                                        ? "float" : "double"));
+    summary.add("threads", qint64(options.threads));
+    summary.add("decoders", qint64(options.decoders));
+    if (options.batch > 0)
+        summary.add("batch", qint64(options.batch));
+    if (options.octaves > 0)
+    {
+        summary.add("octaves", qint64(options.octaves));
+        summary.add("scales_per_octave", qint64(options.scalesPerOctave));
+    }
+    if (options.useGridScan)
+        summary.add("grid_scan", true);
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = true;
+    switch (options.command)
+    {
+    case TRAIN:
+    case BOOTSTRAP:
+        model.setBootstrap(options.command == BOOTSTRAP);
+        model.sampleAndTrain();
+        ok = model.saveModel();
+        error = "can not save model file " + options.model;
+        break;
+    case CLASSIFY:
+    {
+        if (!loadModel(options, model, &error))
+        {
+            ok = false;
+            break;
+        }
+        const qint64 loadMsecs = timer.elapsed();
+        model.classifyDirectory();
+        const qint64 msecs = qMax(timer.elapsed() - loadMsecs, qint64(1));
+        summary.add("load_ms", loadMsecs);
+        summary.add("classify_ms", msecs);
+        summary.add("images", qint64(model.getClassifiedImages()));
+        summary.add("windows", model.getClassifiedWindows());
+        summary.add("images_per_second", model.getClassifiedImages() * 1000.0 / msecs);
+        summary.add("windows_per_second", model.getClassifiedWindows() * 1000.0 / msecs);
+        break;
+    }
+    case EVALUATE:
+        ok = model.estimateQuality();
+        error = "can not open annotation file";
+        summary.add("precision", model.getPrecision());
+        summary.add("recall", model.getRecall());
+        summary.add("f_score", model.getFScore());
+        break;
+    case SCAN:
+    {
+        if (!loadModel(options, model, &error))
+        {
+            ok = false;
+            break;
+        }
+        const qint64 loadMsecs = timer.elapsed();
+        const QImage image = model.scanImage(options.image);
+        summary.add("load_ms", loadMsecs);
+        summary.add("scan_ms", timer.elapsed() - loadMsecs);
+        ok = !image.isNull() && image.save(options.output);
+        error = "can not scan " + options.image + " into " + options.output;
+        break;
+    }
+    case SERVE:
+    {
+        if (!loadModel(options, model, &error))
+        {
+            ok = false;
+            break;
+        }
+        DetectionServer server(model.engine(), options.threads);
+        if (!server.listen(options.socket))
+        {
+            error = "can not listen on " + options.socket + ": " + server.errorString();
+            ok = false;
+            break;
+        }
+        summary.add("load_ms", timer.elapsed());
+        err << "detectorcli: serving on " << options.socket << '\n';
+        err.flush();
+        ok = app.exec() == 0;
+        error = "server stopped with an error";
+        break;
+    }
+    case LOAD:
+        ok = runLoad(options, &summary, &error);
+        break;
+    case SCORES:
+        if (!loadModel(options, model, &error))
+        {
+            ok = false;
+            break;
+        }
+        ok = writeScores(options, model, &summary, &error);
+        break;
+    case COMPARE:
+        ok = compareScores(options, &summary, &error);
+        break;
+    }
+    summary.add("ok", ok);
+    summary.add("total_ms", timer.elapsed());
+
+    out << summary.toString() << '\n';
+    if (!ok)
+    {
+        err << "detectorcli: " << error << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -3,8 +3,12 @@
 
 Controller::Controller(IView* view)
 {
-    m_model = new Model();
     m_view = view;
+    m_pending = 0;
+
+    qRegisterMetaType<Progress>("Progress");
+    m_worker = new ModelWorker();
+    m_worker->moveToThread(&m_thread);
 
     QObject* view_obj = dynamic_cast<QObject*>(m_view);
 
@@ -27,98 +31,152 @@ Controller::Controller(IView* view)
     QObject::connect(view_obj, SIGNAL(setKernel(bool)), this, SLOT(OnSetKernel(bool)));
     QObject::connect(view_obj, SIGNAL(setBound(double)), this, SLOT(onSetBound(double)));
     QObject::connect(view_obj, SIGNAL(crossValidation()), this, SLOT(onCV()));
+    QObject::connect(view_obj, SIGNAL(cancel()), this, SLOT(OnCancel()));
+
+    // Worker signals cross threads, so these are queued connections
+    QObject::connect(m_worker, SIGNAL(progressed(const Progress&)),
+                     this, SLOT(OnProgress(const Progress&)));
+    QObject::connect(m_worker, SIGNAL(warning(const QString&)),
+                     this, SLOT(OnWarning(const QString&)));
+    QObject::connect(m_worker, SIGNAL(qualityEstimated(double, double, double)),
+                     this, SLOT(OnQualityEstimated(double, double, double)));
+    QObject::connect(m_worker, SIGNAL(imageScanned(const QImage&)),
+                     this, SLOT(OnImageScanned(const QImage&)));
+    QObject::connect(m_worker, SIGNAL(finished()), this, SLOT(OnFinished()));
 
-    RefreshViewFull();
+    m_thread.start();
 }
 
 Controller::~Controller()
 {
-    delete m_model;
+    // Let the running operation stop at its next image
+    m_worker->cancel();
+    m_thread.quit();
+    m_thread.wait();
+    delete m_worker;
+}
+
+void Controller::Run(const char *operation, QGenericArgument argument)
+{
+    if (m_pending++ == 0)
+        m_view->setViewBusy(true);
+    QMetaObject::invokeMethod(m_worker, operation, Qt::QueuedConnection, argument);
+}
+
+void Controller::Set(const char *setter, QGenericArgument argument)
+{
+    // Queued as well, so operations asked for earlier still see the old value
+    QMetaObject::invokeMethod(m_worker, setter, Qt::QueuedConnection, argument);
 }
 
 void Controller::OnSaveModel()
 {
-    if (!m_model->saveModel())
-        m_view->showWarning("Can not save model file!");
+    Run("saveModel");
 }
 
 void Controller::OnLoadModel()
 {
-    if (!m_model->loadModel())
-        m_view->showWarning("Can not load model file!");
+    Run("loadModel");
 }
 
 void Controller::OnTrain()
 {
-    m_model->sampleAndTrain();
+    Run("train");
 }
 
 void Controller::OnBootstrap()
 {
-    m_model->setBootstrap(true);
+    Set("setBootstrap", Q_ARG(bool, true));
 }
 
 void Controller::onCV()
 {
-    m_model->crossValidation();
+    Run("crossValidation");
 }
 
 void Controller::OnClassifyDirectory()
 {
-    m_model->classifyDirectory();
+    Run("classifyDirectory");
 }
 
 void Controller::OnEstimateQuality()
 {
-    if (m_model->estimateQuality())
-        RefreshViewPRF();
-    else
-        m_view->showWarning("Can not open annotation file!");
+    Run("estimateQuality");
 }
 
 void Controller::OnScanImage(const QString &imageName)
 {
-    m_view->setViewScannedImage(m_model->scanImage(imageName));
+    Run("scanImage", Q_ARG(QString, imageName));
+}
+
+void Controller::OnCancel()
+{
+    if (!m_pending)
+        return;
+    m_worker->cancel();
+    // Behind every operation queued so far
+    QMetaObject::invokeMethod(m_worker, "resume", Qt::QueuedConnection);
 }
 
 void Controller::OnSetTrueLocationFileName(const QString &fileName)
 {
-    m_model->setTrueLocationFileName(fileName);
+    Set("setTrueLocationFileName", Q_ARG(QString, fileName));
 }
 
 void Controller::OnSetUserLocationFileName(const QString &fileName)
 {
-    m_model->setUserLocationFileName(fileName);
+    Set("setUserLocationFileName", Q_ARG(QString, fileName));
 }
 
 void Controller::OnSetModelFileName(const QString &fileName)
 {
-    m_model->setModelFileName(fileName);
+    Set("setModelFileName", Q_ARG(QString, fileName));
 }
 
 void Controller::OnSetCurrDir(const QString &dirName)
 {
-    m_model->setDirName(dirName);
+    Set("setDirName", Q_ARG(QString, dirName));
 }
 
 void Controller::OnSetKernel(bool useLinear)
 {
-    m_model->setKernel(useLinear);
+    Set("setKernel", Q_ARG(bool, useLinear));
 }
 
 void Controller::onSetBound(double bound)
 {
-    m_model->setBound(bound);
+    Set("setBound", Q_ARG(double, bound));
+}
+
+void Controller::OnProgress(const Progress &progress)
+{
+    m_view->setViewProgress(progress);
+}
+
+void Controller::OnWarning(const QString &message)
+{
+    m_view->showWarning(message);
+}
+
+void Controller::OnQualityEstimated(double precision, double recall, double fScore)
+{
+    RefreshViewPRF(precision, recall, fScore);
+}
+
+void Controller::OnImageScanned(const QImage &image)
+{
+    m_view->setViewScannedImage(image);
 }
 
-void Controller::RefreshViewFull() const
+void Controller::OnFinished()
 {
-    RefreshViewPRF();
+    if (--m_pending == 0)
+        m_view->setViewBusy(false);
 }
 
-void Controller::RefreshViewPRF() const
+void Controller::RefreshViewPRF(double precision, double recall, double fScore) const
 {
-    m_view->setViewPrecision(m_model->getPrecision());
-    m_view->setViewRecall(m_model->getRecall());
-    m_view->setViewFScore(m_model->getFScore());
+    m_view->setViewPrecision(precision);
+    m_view->setViewRecall(recall);
+    m_view->setViewFScore(fScore);
 }
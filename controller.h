@@ -2,7 +2,8 @@
 #define CONTROLLER_H
 
 #include <QObject>
-#include "model.h"
+#include <QThread>
+#include "modelworker.h"
 
 class IView;
 
@@ -15,11 +16,17 @@ public:
     ~Controller();
 
 private:
-    Model* m_model;
+    // Model calls go through the worker on m_thread, see ModelWorker
+    ModelWorker* m_worker;
+    QThread m_thread;
     IView* m_view;
+    // Operations queued on the worker and not finished yet
+    int m_pending;
 
-    void RefreshViewFull() const;
-    void RefreshViewPRF() const;
+    void RefreshViewPRF(double precision, double recall, double fScore) const;
+    void Run(const char *operation,
+             QGenericArgument argument = QGenericArgument(0));
+    void Set(const char *setter, QGenericArgument argument);
 
 private slots:
     void OnSetTrueLocationFileName(const QString &fileName);
@@ -37,7 +44,14 @@ private slots:
     void OnClassifyDirectory();
     void OnEstimateQuality();
     void OnScanImage(const QString &fileName);
+    void OnCancel();
+
+    // From the worker
+    void OnProgress(const Progress &progress);
+    void OnWarning(const QString &message);
+    void OnQualityEstimated(double precision, double recall, double fScore);
+    void OnImageScanned(const QImage &image);
+    void OnFinished();
 };
 
 #endif // CONTROLLER_H
-
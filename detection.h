@@ -0,0 +1,13 @@
+#ifndef DETECTION_H
+#define DETECTION_H
+
+#include <QRect>
+
+// Detected window in image coordinates and its classifier score
+struct Detection
+{
+    QRect box;
+    double score;
+};
+
+#endif // DETECTION_H
@@ -0,0 +1,49 @@
+#include "detectioncontext.h"
+
+DetectionContext::DetectionContext()
+    : m_stream(NULL),
+      m_streamCellSize(0),
+      m_streamBins(0),
+      m_streamWidth(0),
+      m_boundWindows(0),
+      m_boundBlocks(0),
+      m_batchWindows(0),
+      m_growths(0)
+{
+    m_plane.rows = 0;
+    m_plane.cols = 0;
+    m_plane.blockLength = 0;
+}
+
+DetectionContext::~DetectionContext()
+{
+    delete m_stream;
+}
+
+int DetectionContext::growths() const
+{
+    return m_growths;
+}
+
+CellStream &DetectionContext::stream(const QImage &image, int cellSize,
+                                     int bins)
+{
+    if (!m_stream || m_streamCellSize != cellSize || m_streamBins != bins)
+    {
+        delete m_stream;
+        m_stream = new CellStream(image, cellSize, bins);
+        m_streamCellSize = cellSize;
+        m_streamBins = bins;
+        m_streamWidth = image.width();
+        ++m_growths;
+    } else {
+        // The stream keeps its buffers for images up to the widest so far
+        m_stream->reset(image);
+        if (image.width() > m_streamWidth)
+        {
+            m_streamWidth = image.width();
+            ++m_growths;
+        }
+    }
+    return *m_stream;
+}
@@ -0,0 +1,76 @@
+#ifndef DETECTIONCONTEXT_H
+#define DETECTIONCONTEXT_H
+
+#include <QImage>
+#include <QVector>
+#include "cellstream.h"
+#include "detectorengine.h"
+#include "suppression.h"
+
+/* Scratch memory of DetectorEngine::detect() and detectMultiScale().
+
+   The cell stream, cell grid, block plane, window scores and suppression
+   buffers live here instead of in the detection calls. They are sized by
+   the first image and only grow when a larger one arrives, so detecting
+   on images of one size allocates nothing after the first. A context is
+   used by one thread at a time; every worker keeps its own.
+*/
+class DetectionContext
+{
+public:
+    DetectionContext();
+    ~DetectionContext();
+
+    // Number of times a buffer had to grow
+    int growths() const;
+
+    // Resizes a vector that is reused between calls. Reserved vectors keep
+    // their memory when they shrink, so it is only reallocated to grow.
+    template <typename T>
+    static bool reuse(QVector<T> &vector, int size)
+    {
+        const bool grow = vector.capacity() < size;
+        if (grow)
+        {
+            vector.reserve(size);
+        }
+        vector.resize(size);
+        return grow;
+    }
+
+private:
+    Q_DISABLE_COPY(DetectionContext)
+    friend class DetectorEngine;
+
+    CellStream &stream(const QImage &image, int cellSize, int bins);
+    template <typename T>
+    T *buffer(QVector<T> &vector, int size)
+    {
+        m_growths += reuse(vector, size);
+        return vector.data();
+    }
+
+    CellStream *m_stream;
+    int m_streamCellSize;
+    int m_streamBins;
+    int m_streamWidth;
+    // Cell histograms, rows x cols x bins
+    QVector<HogFeature> m_cells;
+    DetectorEngine::BlockPlane m_plane;
+    QVector<double> m_scores;
+    QVector<double> m_dense;
+    QVector<double> m_scratch;
+    Suppression::ColumnWorkspace m_columns;
+    QVector<int> m_kept;
+    QVector<Detection> m_candidates;
+    // Window columns detectWindows() gets from detect()
+    QVector<int> m_areas;
+    // Windows the bound scorer scored since the last probe decision and
+    // the blocks it read for them; windows left for the batch scorers
+    qint64 m_boundWindows;
+    qint64 m_boundBlocks;
+    qint64 m_batchWindows;
+    int m_growths;
+};
+
+#endif // DETECTIONCONTEXT_H
@@ -0,0 +1,132 @@
+#include "detectionprotocol.h"
+#include <QDataStream>
+
+namespace
+{
+
+void setVersion(QDataStream &stream)
+{
+    stream.setVersion(QDataStream::Qt_4_6);
+}
+
+} // namespace
+
+DetectionProtocol::Request::Request()
+    : id(0), kind(IMAGE_PATH), width(0), height(0)
+{
+}
+
+DetectionProtocol::Reply::Reply()
+    : id(0), status(OK), serverUsecs(0)
+{
+}
+
+QByteArray DetectionProtocol::encode(const Request &request)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    setVersion(out);
+    out << request.id << quint8(request.kind);
+    if (request.kind == IMAGE_PATH)
+    {
+        out << request.path;
+    } else {
+        out << qint32(request.width) << qint32(request.height) << request.pixels;
+    }
+    return payload;
+}
+
+QByteArray DetectionProtocol::encode(const Reply &reply)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    setVersion(out);
+    out << reply.id << quint8(reply.status) << reply.serverUsecs <<
+           quint32(reply.detections.size());
+    for (int i = 0; i < reply.detections.size(); ++i)
+    {
+        const Detection &detection = reply.detections[i];
+        out << qint32(detection.box.x()) << qint32(detection.box.y()) <<
+               qint32(detection.box.width()) << qint32(detection.box.height()) <<
+               detection.score;
+    }
+    return payload;
+}
+
+bool DetectionProtocol::decode(const QByteArray &payload, Request *request)
+{
+    QDataStream in(payload);
+    setVersion(in);
+    quint8 kind = 0;
+    in >> request->id >> kind;
+    if (kind == IMAGE_PATH)
+    {
+        request->kind = IMAGE_PATH;
+        in >> request->path;
+    } else if (kind == GRAY_IMAGE) {
+        request->kind = GRAY_IMAGE;
+        qint32 width = 0;
+        qint32 height = 0;
+        in >> width >> height >> request->pixels;
+        request->width = width;
+        request->height = height;
+        if (width <= 0 || height <= 0 ||
+                request->pixels.size() != qint64(width) * height)
+        {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+bool DetectionProtocol::decode(const QByteArray &payload, Reply *reply)
+{
+    QDataStream in(payload);
+    setVersion(in);
+    quint8 status = 0;
+    quint32 count = 0;
+    in >> reply->id >> status >> reply->serverUsecs >> count;
+    reply->status = Status(status);
+    if (in.status() != QDataStream::Ok || count > quint32(payload.size()))
+        return false;
+    reply->detections.resize(count);
+    for (int i = 0; i < reply->detections.size(); ++i)
+    {
+        qint32 x, y, width, height;
+        in >> x >> y >> width >> height >> reply->detections[i].score;
+        reply->detections[i].box = QRect(x, y, width, height);
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+void DetectionProtocol::writeFrame(QIODevice *device, const QByteArray &payload)
+{
+    QByteArray length;
+    QDataStream out(&length, QIODevice::WriteOnly);
+    out << quint32(payload.size());
+    device->write(length);
+    device->write(payload);
+}
+
+bool DetectionProtocol::readFrame(QIODevice *device, QByteArray *payload,
+                                  bool *error)
+{
+    *error = false;
+    if (device->bytesAvailable() < 4)
+        return false;
+    QDataStream in(device->peek(4));
+    quint32 length = 0;
+    in >> length;
+    if (length > quint32(MAX_FRAME))
+    {
+        *error = true;
+        return false;
+    }
+    if (device->bytesAvailable() < 4 + qint64(length))
+        return false;
+    device->read(4);
+    *payload = device->read(length);
+    return true;
+}
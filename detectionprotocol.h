@@ -0,0 +1,72 @@
+#ifndef DETECTIONPROTOCOL_H
+#define DETECTIONPROTOCOL_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QIODevice>
+#include "detection.h"
+
+/* Messages between DetectionServer and its clients.
+
+   Every message is a frame: a big-endian quint32 payload length and the
+   payload, a QDataStream in the Qt 4.6 format. A client may send any
+   number of requests without waiting; replies carry the request id and
+   may come back in any order.
+*/
+namespace DetectionProtocol
+{
+    enum Kind
+    {
+        // Path of an image file the server can read
+        IMAGE_PATH,
+        // width x height bytes of 8-bit gray pixels, rows packed
+        GRAY_IMAGE
+    };
+
+    enum Status
+    {
+        OK,
+        BAD_REQUEST,
+        UNREADABLE_IMAGE,
+        // Too many requests waiting, try again later
+        BUSY
+    };
+
+    enum { MAX_FRAME = 64 * 1024 * 1024 };
+
+    struct Request
+    {
+        Request();
+
+        quint32 id;
+        Kind kind;
+        QString path;
+        int width;
+        int height;
+        QByteArray pixels;
+    };
+
+    struct Reply
+    {
+        Reply();
+
+        quint32 id;
+        Status status;
+        // From the request arriving to the reply being ready
+        qint64 serverUsecs;
+        QVector<Detection> detections;
+    };
+
+    QByteArray encode(const Request &request);
+    QByteArray encode(const Reply &reply);
+    bool decode(const QByteArray &payload, Request *request);
+    bool decode(const QByteArray &payload, Reply *reply);
+
+    void writeFrame(QIODevice *device, const QByteArray &payload);
+    // Takes the next whole frame off 'device' into 'payload'. False when
+    // it has not arrived yet, or, with 'error' set, when it is too long.
+    bool readFrame(QIODevice *device, QByteArray *payload, bool *error);
+}
+
+#endif // DETECTIONPROTOCOL_H
@@ -0,0 +1,224 @@
+#include "detectionserver.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QThread>
+#include <QImage>
+#include <QDebug>
+#include <cstring>
+#include "detectioncontext.h"
+
+namespace
+{
+
+// Indexed8 with the identity gray palette, which the cell stream reads
+// in place
+QImage grayImage(const DetectionProtocol::Request &request)
+{
+    QImage image(request.width, request.height, QImage::Format_Indexed8);
+    QVector<QRgb> table(256);
+    for (int i = 0; i < table.size(); ++i)
+    {
+        table[i] = qRgb(i, i, i);
+    }
+    image.setColorTable(table);
+    for (int y = 0; y < request.height; ++y)
+    {
+        memcpy(image.scanLine(y), request.pixels.constData() + y * request.width,
+               request.width);
+    }
+    return image;
+}
+
+} // namespace
+
+class DetectionServer::Worker : public QThread
+{
+public:
+    explicit Worker(DetectionServer *server)
+        : m_server(server)
+    {
+    }
+
+protected:
+    void run()
+    {
+        m_server->work();
+    }
+
+private:
+    DetectionServer *m_server;
+};
+
+DetectionServer::DetectionServer(const DetectorEngine &engine, int threads,
+                                 QObject *parent)
+    : QObject(parent),
+      m_engine(engine),
+      m_server(new QLocalServer(this)),
+      m_nextConnection(0),
+      m_stopping(false),
+      m_requests(0)
+{
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(acceptConnections()));
+    const int workers = threads > 0 ? threads : qMax(QThread::idealThreadCount(), 1);
+    for (int i = 0; i < workers; ++i)
+    {
+        m_workers.append(new Worker(this));
+        m_workers.last()->start();
+    }
+    qDebug() << "Detecting on" << workers << "threads";
+}
+
+DetectionServer::~DetectionServer()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+    for (int i = 0; i < m_workers.size(); ++i)
+    {
+        m_workers[i]->wait();
+    }
+    qDeleteAll(m_workers);
+}
+
+bool DetectionServer::listen(const QString &name)
+{
+    QLocalServer::removeServer(name);
+    return m_server->listen(name);
+}
+
+QString DetectionServer::errorString() const
+{
+    return m_server->errorString();
+}
+
+void DetectionServer::acceptConnections()
+{
+    while (m_server->hasPendingConnections())
+    {
+        QLocalSocket *socket = m_server->nextPendingConnection();
+        const int connection = m_nextConnection++;
+        socket->setProperty("connection", connection);
+        m_connections.insert(connection, socket);
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequests()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(dropConnection()));
+    }
+}
+
+void DetectionServer::readRequests()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    if (!socket)
+        return;
+    const int connection = socket->property("connection").toInt();
+
+    QByteArray payload;
+    bool error = false;
+    while (DetectionProtocol::readFrame(socket, &payload, &error))
+    {
+        Pending pending;
+        pending.connection = connection;
+        pending.received.start();
+        if (!DetectionProtocol::decode(payload, &pending.request))
+        {
+            DetectionProtocol::Reply reply;
+            reply.id = pending.request.id;
+            reply.status = DetectionProtocol::BAD_REQUEST;
+            DetectionProtocol::writeFrame(socket, DetectionProtocol::encode(reply));
+            continue;
+        }
+
+        QMutexLocker locker(&m_mutex);
+        if (m_pending.size() >= MAX_QUEUED)
+        {
+            locker.unlock();
+            DetectionProtocol::Reply reply;
+            reply.id = pending.request.id;
+            reply.status = DetectionProtocol::BUSY;
+            DetectionProtocol::writeFrame(socket, DetectionProtocol::encode(reply));
+            continue;
+        }
+        m_pending.append(pending);
+        m_wake.wakeOne();
+    }
+    if (error)
+    {
+        // A frame this long is no request, the stream cannot be trusted
+        qDebug() << "Dropping connection" << connection << "after an oversized frame";
+        socket->abort();
+    }
+}
+
+void DetectionServer::dropConnection()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    if (!socket)
+        return;
+    m_connections.remove(socket->property("connection").toInt());
+    socket->deleteLater();
+}
+
+void DetectionServer::sendReplies()
+{
+    QList<Done> done;
+    {
+        QMutexLocker locker(&m_mutex);
+        done.swap(m_done);
+    }
+    for (int i = 0; i < done.size(); ++i)
+    {
+        // The client may have gone in the meantime
+        QLocalSocket *socket = m_connections.value(done[i].connection);
+        if (socket)
+            DetectionProtocol::writeFrame(socket, done[i].reply);
+    }
+}
+
+void DetectionServer::work()
+{
+    DetectionContext context;
+    QMutexLocker locker(&m_mutex);
+    for (;;)
+    {
+        while (m_pending.isEmpty() && !m_stopping)
+        {
+            m_wake.wait(&m_mutex);
+        }
+        if (m_stopping)
+            break;
+        const Pending pending = m_pending.takeFirst();
+        locker.unlock();
+
+        DetectionProtocol::Reply reply;
+        reply.id = pending.request.id;
+        const QImage image = pending.request.kind == DetectionProtocol::GRAY_IMAGE
+                ? grayImage(pending.request) : QImage(pending.request.path);
+        if (image.isNull())
+        {
+            reply.status = DetectionProtocol::UNREADABLE_IMAGE;
+        } else {
+            m_engine.detectWindows(image, context, reply.detections);
+        }
+        reply.serverUsecs = pending.received.nsecsElapsed() / 1000;
+        queueReply(pending.connection, reply);
+
+        locker.relock();
+        if (++m_requests % LOG_REQUESTS == 0)
+        {
+            qDebug() << "Requests:" << m_requests;
+        }
+    }
+}
+
+void DetectionServer::queueReply(int connection, const DetectionProtocol::Reply &reply)
+{
+    Done done;
+    done.connection = connection;
+    done.reply = DetectionProtocol::encode(reply);
+    QMutexLocker locker(&m_mutex);
+    m_done.append(done);
+    // One call sends everything queued until it runs
+    if (m_done.size() == 1)
+        QMetaObject::invokeMethod(this, "sendReplies", Qt::QueuedConnection);
+}
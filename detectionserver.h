@@ -0,0 +1,88 @@
+#ifndef DETECTIONSERVER_H
+#define DETECTIONSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include "detectorengine.h"
+#include "detectionprotocol.h"
+
+class QLocalServer;
+class QLocalSocket;
+
+/* Serves detections with one engine, loaded once, over a local socket
+   (a Unix domain socket, or a named pipe on Windows); see
+   DetectionProtocol for the messages.
+
+   Sockets live in the thread of the server's event loop, which only
+   reads frames and writes replies. A fixed set of worker threads, each
+   with its own detection context, takes the waiting requests one at a
+   time and hands every reply back to the event loop as soon as it is
+   done, so a slow request holds up no other one and no thread is started
+   per request.
+*/
+class DetectionServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 0 threads means one per core
+    DetectionServer(const DetectorEngine &engine, int threads,
+                    QObject *parent = 0);
+    ~DetectionServer();
+
+    // Removes a stale socket of the same name first
+    bool listen(const QString &name);
+    QString errorString() const;
+
+private slots:
+    void acceptConnections();
+    void readRequests();
+    void dropConnection();
+    void sendReplies();
+
+private:
+    enum
+    {
+        // Requests waiting beyond this are answered BUSY
+        MAX_QUEUED = 4096,
+        // Requests between two log lines
+        LOG_REQUESTS = 10000
+    };
+
+    class Worker;
+    struct Pending
+    {
+        int connection;
+        DetectionProtocol::Request request;
+        QElapsedTimer received;
+    };
+    struct Done
+    {
+        int connection;
+        QByteArray reply;
+    };
+
+    void work();
+    void queueReply(int connection, const DetectionProtocol::Reply &reply);
+
+    DetectorEngine m_engine;
+    QLocalServer *m_server;
+    QList<Worker *> m_workers;
+    // Sockets by connection number, only touched by the event loop thread
+    QHash<int, QLocalSocket *> m_connections;
+    int m_nextConnection;
+
+    QMutex m_mutex;
+    QWaitCondition m_wake;
+    QList<Pending> m_pending;
+    QList<Done> m_done;
+    bool m_stopping;
+    // Requests answered by the workers
+    qint64 m_requests;
+};
+
+#endif // DETECTIONSERVER_H
@@ -0,0 +1,62 @@
+# Detection core shared by the GUI (detector.pro) and the console tool
+# (detectorcli.pro)
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/model.cpp \
+    $$PWD/detectorengine.cpp \
+    $$PWD/detectioncontext.cpp \
+    $$PWD/gradient.cpp \
+    $$PWD/grayscale.cpp \
+    $$PWD/cellstream.cpp \
+    $$PWD/cellpyramid.cpp \
+    $$PWD/shiftedcells.cpp \
+    $$PWD/kernelmap.cpp \
+    $$PWD/detectorvariant.cpp \
+    $$PWD/batchscore.cpp \
+    $$PWD/softcascade.cpp \
+    $$PWD/boundscorer.cpp \
+    $$PWD/suppression.cpp \
+    $$PWD/workstealingpool.cpp \
+    $$PWD/imagepipeline.cpp \
+    $$PWD/progress.cpp \
+    $$PWD/liblinear-1.8/tron.cpp \
+    $$PWD/liblinear-1.8/linear.cpp \
+    $$PWD/liblinear-1.8/blas/dscal.c \
+    $$PWD/liblinear-1.8/blas/dnrm2.c \
+    $$PWD/liblinear-1.8/blas/ddot.c \
+    $$PWD/liblinear-1.8/blas/daxpy.c \
+    $$PWD/liblinear-1.8/blas/dgemm.c
+
+HEADERS += \
+    $$PWD/model.h \
+    $$PWD/detectorengine.h \
+    $$PWD/detectioncontext.h \
+    $$PWD/gradient.h \
+    $$PWD/grayscale.h \
+    $$PWD/cellstream.h \
+    $$PWD/cellpyramid.h \
+    $$PWD/shiftedcells.h \
+    $$PWD/detection.h \
+    $$PWD/kernelmap.h \
+    $$PWD/hogcore.h \
+    $$PWD/detectorvariant.h \
+    $$PWD/batchscore.h \
+    $$PWD/softcascade.h \
+    $$PWD/boundscorer.h \
+    $$PWD/suppression.h \
+    $$PWD/workstealingpool.h \
+    $$PWD/boundedqueue.h \
+    $$PWD/imagepipeline.h \
+    $$PWD/progress.h \
+    $$PWD/liblinear-1.8/tron.h \
+    $$PWD/liblinear-1.8/linear.h \
+    $$PWD/liblinear-1.8/blas/blasp.h \
+    $$PWD/liblinear-1.8/blas/blas.h
+
+# qmake CONFIG+=single_precision builds the float32 feature pipeline
+single_precision {
+    DEFINES += DETECTOR_SINGLE_PRECISION
+}
@@ -0,0 +1,19 @@
+# Console front end, see cli.cpp; QImage and QPainter still need QtGui,
+# the detection server and its load generator QtNetwork
+QT       += gui network
+
+TEMPLATE = app
+TARGET = detectorcli
+CONFIG += console
+CONFIG -= app_bundle
+
+include(detector.pri)
+
+SOURCES += \
+    cli.cpp \
+    detectionprotocol.cpp \
+    detectionserver.cpp
+
+HEADERS += \
+    detectionprotocol.h \
+    detectionserver.h
@@ -0,0 +1,635 @@
+#include "detectorengine.h"
+#include <limits>
+#include <QVarLengthArray>
+#include "cellstream.h"
+#include "batchscore.h"
+#include "cellpyramid.h"
+#include "suppression.h"
+#include "detectioncontext.h"
+
+DetectionStats::DetectionStats()
+{
+    clear();
+}
+
+void DetectionStats::clear()
+{
+    windows = 0;
+    cascadeWindows = 0;
+    cascadeRejected.clear();
+    boundWindows = 0;
+    boundBlocks = 0;
+}
+
+void DetectionStats::add(const DetectionStats &other)
+{
+    windows += other.windows;
+    cascadeWindows += other.cascadeWindows;
+    while (cascadeRejected.size() < other.cascadeRejected.size())
+    {
+        cascadeRejected.push_back(0);
+    }
+    for (int i = 0; i < other.cascadeRejected.size(); ++i)
+    {
+        cascadeRejected[i] += other.cascadeRejected[i];
+    }
+    boundWindows += other.boundWindows;
+    boundBlocks += other.boundBlocks;
+}
+
+DetectorEngine::Settings::Settings()
+    : variant(DetectorVariants::defaultVariant()),
+      useLinear(true),
+      n(1),
+      L(0.27),
+      bound(0.3),
+      useCascade(false),
+      useEarlyTermination(true),
+      octaves(0),
+      scalesPerOctave(4),
+      useGridScan(false),
+      strideX(1),
+      strideY(1),
+      pixelStrideX(0),
+      pixelStrideY(0)
+{
+}
+
+DetectorEngine::DetectorEngine()
+    : m_variant(m_settings.variant),
+      m_mapLength(2 * (2 * m_settings.n + 1))
+{
+}
+
+DetectorEngine::DetectorEngine(const Settings &settings)
+    : m_settings(settings),
+      m_variant(settings.variant),
+      m_mapLength(2 * (2 * settings.n + 1))
+{
+    // Mapped blocks are looked up in the table, so it has to cover every
+    // ratio of the variant
+    const int tableLength = kernelMapIndex(0, m_variant->blockPixels + 1) * m_mapLength;
+    if (!m_settings.useLinear && m_settings.kernelMap.size() != tableLength)
+    {
+        m_settings.kernelMap = buildKernelMap(m_variant->blockPixels,
+                                              m_settings.n, m_settings.L);
+    }
+}
+
+const DetectorEngine::Settings &DetectorEngine::settings() const
+{
+    return m_settings;
+}
+
+const DetectorVariant *DetectorEngine::variant() const
+{
+    return m_variant;
+}
+
+int DetectorEngine::kernelMapIndex(int numerator, int denominator)
+{
+    return denominator * (denominator + 1) / 2 + numerator;
+}
+
+QVector<DetectorEngine::Feature> DetectorEngine::buildKernelMap(int blockPixels,
+                                                                int n, double L)
+{
+    const int mapLength = 2 * (2 * n + 1);
+    QVector<Feature> table(kernelMapIndex(0, blockPixels + 1) * mapLength);
+    Feature *mapped = table.data();
+    for (int denominator = 0; denominator <= blockPixels; ++denominator)
+    {
+        for (int numerator = 0; numerator <= denominator; ++numerator)
+        {
+            mapFeature(denominator == 0 ? 0 : double(numerator) / denominator,
+                       n, L, mapped);
+            mapped += mapLength;
+        }
+    }
+    return table;
+}
+
+DetectorEngine::CellGrid::CellGrid(const QVector<QVector<Cell> > &cells)
+    : m_nested(&cells),
+      m_data(NULL),
+      m_rows(cells.size()),
+      m_cols(cells.isEmpty() ? 0 : cells[0].size()),
+      m_bins(0)
+{
+}
+
+DetectorEngine::CellGrid::CellGrid(const Feature *data, int rows, int cols,
+                                   int bins)
+    : m_nested(NULL),
+      m_data(data),
+      m_rows(rows),
+      m_cols(cols),
+      m_bins(bins)
+{
+}
+
+QVector<int> DetectorEngine::detect(const QImage &image,
+                                    DetectionStats *stats) const
+{
+    DetectionContext context;
+    QVector<int> areas;
+    detect(image, context, areas, stats);
+    return areas;
+}
+
+void DetectorEngine::detect(const QImage &image, DetectionContext &context,
+                            QVector<int> &areas, DetectionStats *stats) const
+{
+    /* Detect objects in image using sliding window technique.
+
+       Windows of the top window row scoring above the bound, best first,
+       each one hiding the windows overlapping it by more than CROSS_PROC
+       percent.
+    */
+    DetectionContext::reuse(areas, 0);
+    CellGrid cells = readCells(image, m_variant->winHeightCell, context);
+
+    //        slide with window along image and score each considering
+    //        region, all windows at once from the block plane
+    const BlockPlane &blocks = computeBlockPlane(cells, m_variant->winHeightCell,
+                                                 !m_settings.useLinear, context);
+    if (blocks.rows < m_variant->winBlocksY || blocks.cols < m_variant->winBlocksX)
+    {
+        return;
+    }
+    QVector<double> &buff = context.m_scores;
+    scoreWindows(blocks, 0, cells.cols() - m_variant->winWidthCell, 1,
+                 context, stats);
+    for (int i = 0; i < buff.size(); ++i)
+    {
+        double prob_estimate = buff[i];  // level of confidence
+
+        if (prob_estimate <= m_settings.bound)
+        {
+            buff[i] = 0;
+        }
+    }
+    QVector<int> &columns = context.m_kept;
+    Suppression::suppressColumns(buff, m_variant->winWidthCell * CROSS_PROC / 100,
+                                 context.m_columns, columns);
+    DetectionContext::reuse(areas, columns.size());
+    int count = 0;
+    for (int i = 0; i < columns.size(); ++i)
+    {
+        if (columns[i] > 0)
+        {
+            areas[count++] = columns[i] * m_variant->cellSize;
+        }
+    }
+    areas.resize(count);
+}
+
+DetectorEngine::CellGrid DetectorEngine::readCells(const QImage &image,
+                                                   int maxRows,
+                                                   DetectionContext &context) const
+{
+    // Cells of the first 'maxRows' rows into the context, as computeCells()
+    const int bins = m_variant->bins;
+    CellStream &stream = context.stream(image, m_variant->cellSize, bins);
+    const int rows = qMin(stream.rows(), maxRows);
+    const int cols = stream.cols();
+    const int rowLength = cols * bins;
+    Feature *data = context.buffer(context.m_cells, rows * rowLength);
+    for (int y = 0; y < rows && stream.readRow(data + y * rowLength); ++y)
+    {
+    }
+    // The context should not keep the image alive
+    stream.reset(QImage());
+    return CellGrid(data, rows, cols, bins);
+}
+
+void DetectorEngine::scanCells(const CellGrid &cells, double scale,
+                               int offsetX, int offsetY,
+                               DetectionContext &context,
+                               DetectionStats *stats) const
+{
+    /* Windows of one cell grid above the bound, boxes scaled back by
+       1 / scale and added to the candidates of 'context'. The grid starts
+       at pixel (offsetX, offsetY) of its level.
+       Without the grid scan only the top window row is scanned, as in
+       detect(). With it every strideY-th window row and strideX-th column
+       is, all from one block plane over the whole grid.
+    */
+    const bool gridScan = m_settings.useGridScan;
+    const int strideX = gridScan ? m_settings.strideX : 1;
+    const int strideY = gridScan ? m_settings.strideY : 1;
+    const int cellRows = gridScan ? cells.rows() : m_variant->winHeightCell;
+    const BlockPlane &blocks = computeBlockPlane(cells, cellRows,
+                                                 !m_settings.useLinear, context);
+    if (blocks.rows < m_variant->winBlocksY || blocks.cols < m_variant->winBlocksX)
+    {
+        return;
+    }
+
+    // The top row keeps the window count of detect()
+    const int positions = cells.cols() - m_variant->winWidthCell;
+    const int columns = gridScan ? positions / strideX + 1 : positions;
+    const int cellSize = m_variant->cellSize;
+    for (int y = 0; y + m_variant->winHeightCell <= cellRows; y += strideY)
+    {
+        const QVector<double> &scores = scoreWindows(blocks, y, columns, strideX,
+                                                     context, stats);
+        for (int i = 0; i < scores.size(); ++i)
+        {
+            if (scores[i] > m_settings.bound)
+            {
+                Detection detection;
+                detection.box = QRect(qRound((offsetX + i * strideX * cellSize) / scale),
+                                      qRound((offsetY + y * cellSize) / scale),
+                                      qRound(m_variant->winWidth / scale),
+                                      qRound(m_variant->winHeight / scale));
+                detection.score = scores[i];
+                context.m_candidates.push_back(detection);
+            }
+        }
+    }
+}
+
+QVector<Detection> DetectorEngine::detectMultiScale(const QImage &image,
+                                                    DetectionStats *stats) const
+{
+    DetectionContext context;
+    QVector<Detection> detections;
+    detectMultiScale(image, context, detections, stats);
+    return detections;
+}
+
+void DetectorEngine::detectMultiScale(const QImage &image,
+                                      DetectionContext &context,
+                                      QVector<Detection> &detections,
+                                      DetectionStats *stats) const
+{
+    /* Windows of every pyramid level, mapped back to image coordinates.
+       Level cells come from CellPyramid, so only octaves are computed from
+       pixels; each level is scanned by scanCells(). With no octaves the
+       only level is the image itself. Octave levels are also scanned at
+       every sub-cell offset of the pixel strides, vertical ones only with
+       the grid scan.
+    */
+    const int cellSize = m_variant->cellSize;
+    const int pixelStrideX = m_settings.pixelStrideX;
+    const int pixelStrideY = m_settings.pixelStrideY;
+    const int strideX = pixelStrideX > 0 && cellSize % pixelStrideX == 0
+            ? pixelStrideX : cellSize;
+    const int strideY = m_settings.useGridScan && pixelStrideY > 0 &&
+            cellSize % pixelStrideY == 0 ? pixelStrideY : cellSize;
+    CellPyramid pyramid(image, cellSize, m_variant->bins, m_settings.octaves,
+                        m_settings.scalesPerOctave, m_variant->winHeightCell,
+                        m_variant->winWidthCell + 1, strideX, strideY);
+    DetectionContext::reuse(context.m_candidates, 0);
+    for (int l = 0; l < pyramid.levels(); ++l)
+    {
+        const CellPyramid::Level &level = pyramid.level(l);
+        if (level.shifted.isEmpty())
+        {
+            scanCells(level.cells, level.scale, 0, 0, context, stats);
+            continue;
+        }
+        const int offsetsX = cellSize / strideX;
+        for (int i = 0; i < level.shifted.size(); ++i)
+        {
+            scanCells(level.shifted[i], level.scale, i % offsetsX * strideX,
+                      i / offsetsX * strideY, context, stats);
+        }
+    }
+
+    detections = Suppression::suppressBoxes(context.m_candidates, CROSS_PROC / 100.0);
+}
+
+bool DetectorEngine::detectsBoxes() const
+{
+    // Modes whose windows are not all at y = 0 and of the window size
+    return m_settings.octaves > 0 || m_settings.useGridScan ||
+            m_settings.pixelStrideX > 0 || m_settings.pixelStrideY > 0;
+}
+
+void DetectorEngine::detectWindows(const QImage &image, DetectionContext &context,
+                                   QVector<Detection> &detections,
+                                   DetectionStats *stats) const
+{
+    if (detectsBoxes())
+    {
+        detectMultiScale(image, context, detections, stats);
+        return;
+    }
+
+    // detect() leaves the score of every window column in the context
+    QVector<int> &areas = context.m_areas;
+    detect(image, context, areas, stats);
+    DetectionContext::reuse(detections, areas.size());
+    for (int i = 0; i < areas.size(); ++i)
+    {
+        detections[i].box = QRect(areas[i], 0, m_variant->winWidth,
+                                  m_variant->winHeight);
+        detections[i].score = context.m_scores[areas[i] / m_variant->cellSize];
+    }
+}
+
+QVector<QVector<DetectorEngine::Cell> > DetectorEngine::computeCells(const QImage &image,
+                                                                     int maxRows) const
+{
+    // Rows past 'maxRows' (if >= 0) are never computed
+    CellStream stream(image, m_variant->cellSize, m_variant->bins);
+    const int rows = maxRows < 0 ? stream.rows() : qMin(stream.rows(), maxRows);
+    QVector<QVector<Cell> > cells;
+    cells.reserve(rows);
+    QVector<Cell> row;
+    while (cells.size() < rows && stream.readRow(row))
+    {
+        cells.push_back(row);
+    }
+
+    return cells;
+}
+
+void DetectorEngine::sumBlock(const CellGrid &cells, int y, int x,
+                              double *localCell) const
+{
+    const int bins = m_variant->bins;
+    qFill(localCell, localCell + bins, 0.0);
+    for (int i = 0; i < m_variant->blockSize; ++i)
+    {
+        for (int j = 0; j < m_variant->blockSize; ++j)
+        {
+            const Feature *cell = cells.cell(y + i, x + j);
+            for (int k = 0; k < bins; ++k)
+            {
+                localCell[k] += cell[k];
+            }
+        }
+    }
+}
+
+void DetectorEngine::computeMappedBlock(const CellGrid &cells, int y, int x,
+                                        Feature *block) const
+{
+    /* Same as m_variant->computeBlock() followed by the kernel map, but
+       looks the mapped values up in the kernel map table. Every feature is
+       a ratio of two pixel counts, numerator <= denominator <= blockPixels,
+       so the table holds the exact result; anything else is mapped by
+       mapFeature().
+    */
+    const int bins = m_variant->bins;
+    QVarLengthArray<double, 16> localCell(bins);
+    sumBlock(cells, y, x, localCell.data());
+    for (int i = 0; i < m_variant->blockSize; ++i)
+    {
+        for (int j = 0; j < m_variant->blockSize; ++j)
+        {
+            const Feature *cell = cells.cell(y + i, x + j);
+            for (int k = 0; k < bins; ++k)
+            {
+                int numerator = int(cell[k]);
+                int denominator = int(localCell[k]);
+                if (numerator == cell[k] && denominator == localCell[k] &&
+                        numerator >= 0 && denominator <= m_variant->blockPixels)
+                {
+                    const Feature *mapped = m_settings.kernelMap.constData() +
+                            kernelMapIndex(numerator, denominator) * m_mapLength;
+                    qCopy(mapped, mapped + m_mapLength, block);
+                } else {
+                    mapFeature(localCell[k] == 0 ? 0 : cell[k] / localCell[k],
+                               m_settings.n, m_settings.L, block);
+                }
+                block += m_mapLength;
+            }
+        }
+    }
+}
+
+QVector<DetectorEngine::Feature> DetectorEngine::computeFeatures(
+        const QVector<QVector<Cell> > &cells, int shift) const
+{
+    if (!m_settings.useLinear)
+    {
+        const int blockLength = m_variant->blockFeatures * m_mapLength;
+        QVector<Feature> features(m_variant->winBlocksY * m_variant->winBlocksX *
+                                  blockLength);
+        Feature *block = features.data();
+        const CellGrid grid(cells);
+        for (int y = 0; y < m_variant->winBlocksY; ++ y)
+        {
+            for (int x = 0; x < m_variant->winBlocksX; ++x)
+            {
+                computeMappedBlock(grid, y, x + shift, block);
+                block += blockLength;
+            }
+        }
+        return features;
+    }
+
+    QVector<Feature> features(m_variant->descriptorLength);
+    m_variant->computeDescriptor(cells, shift, features.data());
+    return features;
+}
+
+double DetectorEngine::scoreWindow(const QVector<QVector<Cell> > &cells,
+                                   int shift) const
+{
+    const QVector<Feature> &weights = m_settings.weights;
+    if (m_settings.useLinear)
+    {
+        return m_variant->scoreWindow(cells, shift, weights.constData());
+    }
+
+    const QVector<Feature> features = computeFeatures(cells, shift);
+    double score = 0;
+    for (int k = 0; k < features.size(); ++k)
+    {
+        score += weights[k] * features[k];
+    }
+    return score;
+}
+
+const DetectorEngine::BlockPlane &DetectorEngine::computeBlockPlane(
+        const CellGrid &cells, int cellRows, bool mapped,
+        DetectionContext &context) const
+{
+    /* Descriptors of all blocks the sliding window can cover within the
+       first 'cellRows' cell rows, computed once per image into the plane
+       of 'context'. Window at 'shift' is then the strided view
+       data[(y * cols + shift + x) * blockLength], y < winBlocksY,
+       x < winBlocksX, which is laid out exactly like computeFeatures().
+       Blocks hold raw HOG ratios unless 'mapped' asks for the kernel map.
+    */
+    BlockPlane &plane = context.m_plane;
+    const int blockSize = m_variant->blockSize;
+    plane.rows = qMin(cells.rows(), cellRows) - blockSize + 1;
+    plane.cols = cells.cols() - blockSize + 1;
+    plane.blockLength = mapped ? m_variant->blockFeatures * m_mapLength
+                               : m_variant->blockFeatures;
+    if (plane.rows <= 0 || plane.cols <= 0)
+    {
+        plane.rows = plane.cols = 0;
+        return plane;
+    }
+
+    Feature *out = context.buffer(plane.data, plane.rows * plane.cols * plane.blockLength);
+    QVarLengthArray<const Feature *, 16> blockCells(blockSize * blockSize);
+    for (int y = 0; y < plane.rows; ++y)
+    {
+        for (int x = 0; x < plane.cols; ++x)
+        {
+            if (mapped)
+            {
+                computeMappedBlock(cells, y, x, out);
+            } else {
+                for (int c = 0; c < blockCells.size(); ++c)
+                {
+                    blockCells[c] = cells.cell(y + c / blockSize, x + c % blockSize);
+                }
+                m_variant->normalizeBlock(blockCells.constData(), out);
+            }
+            out += plane.blockLength;
+        }
+    }
+
+    return plane;
+}
+
+const QVector<double> &DetectorEngine::scoreWindows(const BlockPlane &plane,
+                                                    int row, int windows,
+                                                    int stride,
+                                                    DetectionContext &context,
+                                                    DetectionStats *stats) const
+{
+    /* Scores of the windows at block row 'row' and shifts i * stride,
+       i < windows. Window (row, shift) starts at block row * cols + shift
+       of the plane, so every per-window scorer takes that as its shift.
+       With the cascade on, linear windows are scored one by one and most
+       of them stop early. Otherwise linear planes, raw or mapped, are
+       scored all at once as matrix products (see BatchScore), the single
+       precision build keeps the block-major pass of HogCore::scoreWindows
+       for raw planes.
+       Early termination scores linear windows one by one as well, but
+       only windows that can not exceed the bound stop early (see
+       BoundScorer). Reading most blocks that way is no faster than the
+       batch scorers: on the 80x200 variant it broke even at about 80% of
+       the blocks read, while at usual bounds it reads over 95%. So it is
+       used while its measured share of blocks read stays below
+       BOUND_BREAK_EVEN and probed again every BOUND_RECHECK windows.
+       Scores go to the score buffer of 'context'.
+    */
+    QVector<double> &scores = context.m_scores;
+    context.buffer(scores, qMax(windows, 0));
+    if (scores.isEmpty())
+    {
+        return scores;
+    }
+    if (stats)
+    {
+        stats->windows += scores.size();
+    }
+    const QVector<Feature> &weights = m_settings.weights;
+    const SoftCascade &cascade = m_settings.cascade;
+    const BoundScorer &boundScorer = m_settings.boundScorer;
+    const int first = row * plane.cols;
+    if (m_settings.useCascade && !cascade.isEmpty() &&
+            plane.blockLength * m_variant->winBlocksX * m_variant->winBlocksY ==
+            weights.size())
+    {
+        // Rejected windows get a score no bound can accept
+        QVarLengthArray<qint64, 16> rejected(qMax(cascade.stages() - 1, 0));
+        qFill(rejected.begin(), rejected.end(), 0);
+        for (int i = 0; i < scores.size(); ++i)
+        {
+            int stage = 0;
+            if (!cascade.scoreWindow(plane.data.constData(), plane.cols,
+                                     first + i * stride, &scores[i], &stage))
+            {
+                scores[i] = -std::numeric_limits<double>::max();
+                ++rejected[stage];
+            }
+        }
+        if (stats)
+        {
+            while (stats->cascadeRejected.size() < rejected.size())
+            {
+                stats->cascadeRejected.push_back(0);
+            }
+            for (int i = 0; i < rejected.size(); ++i)
+            {
+                stats->cascadeRejected[i] += rejected[i];
+            }
+            stats->cascadeWindows += scores.size();
+        }
+        return scores;
+    }
+    if (m_settings.useEarlyTermination && !boundScorer.isEmpty() &&
+            plane.blockLength * boundScorer.blocks() == weights.size() &&
+            context.m_batchWindows <= 0)
+    {
+        qint64 blocksRead = 0;
+        for (int i = 0; i < scores.size(); ++i)
+        {
+            int blocks = 0;
+            if (!boundScorer.scoreWindow(plane.data.constData(), plane.cols,
+                                         first + i * stride, m_settings.bound,
+                                         &scores[i], &blocks))
+            {
+                scores[i] = -std::numeric_limits<double>::max();
+            }
+            blocksRead += blocks;
+        }
+        context.m_boundWindows += scores.size();
+        context.m_boundBlocks += blocksRead;
+        if (context.m_boundWindows >= BOUND_PROBE)
+        {
+            if (context.m_boundBlocks * 100 >=
+                    context.m_boundWindows * boundScorer.blocks() * BOUND_BREAK_EVEN)
+            {
+                context.m_batchWindows = BOUND_RECHECK;
+            }
+            context.m_boundWindows = 0;
+            context.m_boundBlocks = 0;
+        }
+        if (stats)
+        {
+            stats->boundBlocks += blocksRead;
+            stats->boundWindows += scores.size();
+        }
+        return scores;
+    }
+    // Every shift of the row is scored, strided ones are picked after
+    const int shifts = (scores.size() - 1) * stride + 1;
+    const Feature *origin = plane.data.constData() + first * plane.blockLength;
+    double *dense = context.buffer(context.m_dense, shifts);
+#ifndef DETECTOR_SINGLE_PRECISION
+    double *scratch = context.buffer(context.m_scratch,
+                                     (shifts + m_variant->winBlocksX - 1) *
+                                     m_variant->winBlocksX);
+    BatchScore::scoreWindows(origin, plane.cols, plane.blockLength,
+                             m_variant->winBlocksX, m_variant->winBlocksY,
+                             weights.constData(), shifts, dense, scratch);
+#else
+    if (plane.blockLength == m_variant->blockFeatures)
+    {
+        m_variant->scoreWindows(origin, plane.cols, shifts,
+                                weights.constData(), dense);
+    } else {
+        BatchScore::scoreWindows(origin, plane.cols, plane.blockLength,
+                                 m_variant->winBlocksX, m_variant->winBlocksY,
+                                 weights.constData(), shifts, dense);
+    }
+#endif
+    context.m_batchWindows -= scores.size();
+    for (int i = 0; i < scores.size(); ++i)
+    {
+        scores[i] = dense[i * stride];
+    }
+
+    return scores;
+}
+
+void DetectorEngine::mapFeature(double value, int n, double L, Feature *mapped)
+{
+    const int mapLength = 2 * (2 * n + 1);
+    QVarLengthArray<double, 16> exact(mapLength);
+    kernelMap(value, n, L, exact.data());
+    qCopy(exact.constData(), exact.constData() + mapLength, mapped);
+}
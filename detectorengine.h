@@ -0,0 +1,188 @@
+#ifndef DETECTORENGINE_H
+#define DETECTORENGINE_H
+
+#include <QImage>
+#include <QVector>
+#include "kernelmap.h"
+#include "softcascade.h"
+#include "boundscorer.h"
+#include "detectorvariant.h"
+#include "detection.h"
+
+class DetectionContext;
+
+// Work done by the detection calls of one caller
+struct DetectionStats
+{
+    DetectionStats();
+    void clear();
+    // Adds the counters of another caller
+    void add(const DetectionStats &other);
+
+    // Windows scored
+    qint64 windows;
+    // Windows scored through the cascade and how many each stage rejected
+    qint64 cascadeWindows;
+    QVector<qint64> cascadeRejected;
+    // Windows scored through the bound scorer and the blocks they read
+    qint64 boundWindows;
+    qint64 boundBlocks;
+};
+
+/* Everything detection needs, frozen: the variant, the weights and the
+   scorers built from them, the kernel map and the scan settings.
+
+   An engine is never changed after construction and every method is
+   const, so any number of threads can detect with the same engine at
+   once. Work counters go to the DetectionStats the caller passes, one
+   per thread. The vectors inside are implicitly shared, so copying an
+   engine only copies references. Model::engine() builds one from the
+   current model.
+*/
+class DetectorEngine
+{
+public:
+    typedef HogFeature Feature;
+    typedef HogCell Cell;
+
+    struct Settings
+    {
+        Settings();
+
+        const DetectorVariant *variant;
+        bool useLinear;
+        // Kernel map parameters, see kernelMap()
+        int n;
+        double L;
+        double bound;
+        // Linear weights, empty before training
+        QVector<Feature> weights;
+        // Mapped values of every ratio of block pixel counts, see
+        // kernelMapIndex(); only used when useLinear is false
+        QVector<Feature> kernelMap;
+        // Used only if useCascade is set, and then has to be calibrated
+        SoftCascade cascade;
+        bool useCascade;
+        BoundScorer boundScorer;
+        bool useEarlyTermination;
+        // See Model::setPyramid(), setGridScan(), setStrides() and
+        // setPixelStrides()
+        int octaves;
+        int scalesPerOctave;
+        bool useGridScan;
+        int strideX;
+        int strideY;
+        int pixelStrideX;
+        int pixelStrideY;
+    };
+
+    // Per-image plane of block descriptors, see computeBlockPlane()
+    struct BlockPlane
+    {
+        int rows;
+        int cols;
+        int blockLength;
+        QVector<Feature> data;
+    };
+
+    DetectorEngine();
+    explicit DetectorEngine(const Settings &settings);
+
+    const Settings &settings() const;
+    const DetectorVariant *variant() const;
+
+    // Left cell columns times cellSize of the windows of the top window
+    // row kept by suppression
+    QVector<int> detect(const QImage &image, DetectionStats *stats = NULL) const;
+    // Same, into 'areas', with all scratch memory taken from 'context'.
+    // Once the context and 'areas' have seen an image as large, this
+    // allocates nothing.
+    void detect(const QImage &image, DetectionContext &context,
+                QVector<int> &areas, DetectionStats *stats = NULL) const;
+    // Windows of every pyramid level in image coordinates
+    QVector<Detection> detectMultiScale(const QImage &image,
+                                        DetectionStats *stats = NULL) const;
+    // Same, reusing the block plane, score and candidate buffers of
+    // 'context'; pyramid levels and box suppression still allocate
+    void detectMultiScale(const QImage &image, DetectionContext &context,
+                          QVector<Detection> &detections,
+                          DetectionStats *stats = NULL) const;
+    // Whether detectMultiScale() is the detector of these settings
+    bool detectsBoxes() const;
+    // Detections of whichever of detect() and detectMultiScale() these
+    // settings select, with their scores; windows of detect() are of the
+    // window size at the top of the image
+    void detectWindows(const QImage &image, DetectionContext &context,
+                       QVector<Detection> &detections,
+                       DetectionStats *stats = NULL) const;
+
+    QVector<QVector<Cell> > computeCells(const QImage &image, int maxRows = -1) const;
+    // Descriptor of the window at cell column 'shift', kernel mapped
+    // unless useLinear is set
+    QVector<Feature> computeFeatures(const QVector<QVector<Cell> > &cells,
+                                     int shift = 0) const;
+    // Full score of that window. Linear windows are scored from a
+    // descriptor on the stack and allocate nothing.
+    double scoreWindow(const QVector<QVector<Cell> > &cells, int shift = 0) const;
+
+    // Row of the kernel map table holding the mapped value of
+    // numerator / denominator
+    static int kernelMapIndex(int numerator, int denominator);
+    // Settings::kernelMap for blocks of blockPixels pixels
+    static QVector<Feature> buildKernelMap(int blockPixels, int n, double L);
+
+private:
+    enum { CROSS_PROC = 50 };
+    // Early termination is probed on BOUND_PROBE windows and kept while
+    // it reads fewer than BOUND_BREAK_EVEN percent of the blocks, else the
+    // batch scorers take the next BOUND_RECHECK windows
+    enum { BOUND_PROBE = 2048, BOUND_BREAK_EVEN = 80, BOUND_RECHECK = 32768 };
+
+    // Cell histograms addressed by row and column, either a nested grid
+    // or rows x cols x bins values in one array
+    class CellGrid
+    {
+    public:
+        CellGrid(const QVector<QVector<Cell> > &cells);
+        CellGrid(const Feature *data, int rows, int cols, int bins);
+
+        int rows() const { return m_rows; }
+        int cols() const { return m_cols; }
+        const Feature *cell(int y, int x) const
+        {
+            return m_nested ? (*m_nested)[y][x].constData()
+                            : m_data + (y * m_cols + x) * m_bins;
+        }
+
+    private:
+        const QVector<QVector<Cell> > *m_nested;
+        const Feature *m_data;
+        int m_rows;
+        int m_cols;
+        int m_bins;
+    };
+
+    CellGrid readCells(const QImage &image, int maxRows,
+                       DetectionContext &context) const;
+    void scanCells(const CellGrid &cells, double scale, int offsetX,
+                   int offsetY, DetectionContext &context,
+                   DetectionStats *stats) const;
+    void sumBlock(const CellGrid &cells, int y, int x, double *localCell) const;
+    void computeMappedBlock(const CellGrid &cells, int y, int x,
+                            Feature *block) const;
+    const BlockPlane &computeBlockPlane(const CellGrid &cells, int cellRows,
+                                        bool mapped,
+                                        DetectionContext &context) const;
+    const QVector<double> &scoreWindows(const BlockPlane &plane, int row,
+                                        int windows, int stride,
+                                        DetectionContext &context,
+                                        DetectionStats *stats) const;
+    static void mapFeature(double value, int n, double L, Feature *mapped);
+
+    Settings m_settings;
+    // Shorthands into m_settings
+    const DetectorVariant *m_variant;
+    int m_mapLength;
+};
+
+#endif // DETECTORENGINE_H
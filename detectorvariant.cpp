@@ -0,0 +1,72 @@
+#include "detectorvariant.h"
+
+namespace
+{
+
+template <class Geometry>
+DetectorVariant makeVariant(const char *name)
+{
+    DetectorVariant variant;
+    variant.name = name;
+    variant.cellSize = Geometry::CELL_SIZE;
+    variant.blockSize = Geometry::BLOCK_SIZE;
+    variant.bins = Geometry::BINS;
+    variant.winWidthCell = Geometry::WIN_WIDTH_CELL;
+    variant.winHeightCell = Geometry::WIN_HEIGHT_CELL;
+    variant.winWidth = Geometry::WIN_WIDTH;
+    variant.winHeight = Geometry::WIN_HEIGHT;
+    variant.winBlocksX = Geometry::WIN_BLOCKS_X;
+    variant.winBlocksY = Geometry::WIN_BLOCKS_Y;
+    variant.blockFeatures = Geometry::BLOCK_FEATURES;
+    variant.blockPixels = Geometry::BLOCK_PIXELS;
+    variant.descriptorLength = Geometry::DESCRIPTOR_LENGTH;
+    variant.normalizeBlock = &HogCore<Geometry>::normalizeBlock;
+    variant.computeDescriptor = &HogCore<Geometry>::computeDescriptor;
+    variant.scoreWindow = &HogCore<Geometry>::scoreWindow;
+    variant.scoreWindows = &HogCore<Geometry>::scoreWindows;
+    return variant;
+}
+
+const DetectorVariant variants[] =
+{
+    makeVariant<DetectorVariants::Pedestrian80x200>("80x200"),
+    makeVariant<DetectorVariants::Pedestrian64x128>("64x128")
+};
+
+} // namespace
+
+int DetectorVariants::count()
+{
+    return sizeof(variants) / sizeof(variants[0]);
+}
+
+const DetectorVariant *DetectorVariants::at(int i)
+{
+    return &variants[i];
+}
+
+const DetectorVariant *DetectorVariants::defaultVariant()
+{
+    return &variants[0];
+}
+
+const DetectorVariant *DetectorVariants::byName(const QString &name)
+{
+    for (int i = 0; i < count(); ++i)
+    {
+        if (name == variants[i].name)
+            return &variants[i];
+    }
+    return NULL;
+}
+
+const DetectorVariant *DetectorVariants::byFeatures(int featuresNumber,
+                                                    int mapLength)
+{
+    for (int i = 0; i < count(); ++i)
+    {
+        if (variants[i].descriptorLength * mapLength == featuresNumber)
+            return &variants[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,54 @@
+#ifndef DETECTORVARIANT_H
+#define DETECTORVARIANT_H
+
+#include <QString>
+#include "hogcore.h"
+
+/* Runtime record of one HogCore<> instantiation.
+
+   DetectorEngine keeps a pointer to the variant it detects with and calls
+   the specialized kernels through it.
+*/
+struct DetectorVariant
+{
+    const char *name;
+
+    int cellSize;
+    int blockSize;
+    int bins;
+    int winWidthCell;
+    int winHeightCell;
+    int winWidth;
+    int winHeight;
+    int winBlocksX;
+    int winBlocksY;
+    int blockFeatures;
+    int blockPixels;
+    int descriptorLength;
+
+    void (*normalizeBlock)(const HogFeature *const *blockCells,
+                           HogFeature *block);
+    void (*computeDescriptor)(const HogCells &cells, int shift,
+                              HogFeature *descriptor);
+    double (*scoreWindow)(const HogCells &cells, int shift,
+                          const HogFeature *w);
+    void (*scoreWindows)(const HogFeature *plane, int cols, int windows,
+                         const HogFeature *w, double *scores);
+};
+
+namespace DetectorVariants
+{
+    typedef HogGeometry<8, 2, 8, 10, 25> Pedestrian80x200;
+    typedef HogGeometry<8, 2, 8, 8, 16> Pedestrian64x128;
+
+    int count();
+    const DetectorVariant *at(int i);
+    // The 80x200 window the detector was originally built for
+    const DetectorVariant *defaultVariant();
+    const DetectorVariant *byName(const QString &name);
+    // Variant whose descriptor, expanded mapLength times by the kernel
+    // map, has featuresNumber elements; NULL if there is none
+    const DetectorVariant *byFeatures(int featuresNumber, int mapLength);
+}
+
+#endif // DETECTORVARIANT_H
@@ -0,0 +1,220 @@
+#include "gradient.h"
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+inline void sobelPixel(const unsigned char *above, const unsigned char *row,
+                       const unsigned char *below, int x,
+                       short *dx, short *dy)
+{
+    int left = above[x - 1] + 2 * row[x - 1] + below[x - 1];
+    int right = above[x + 1] + 2 * row[x + 1] + below[x + 1];
+    int top = above[x - 1] + 2 * above[x] + above[x + 1];
+    int bottom = below[x - 1] + 2 * below[x] + below[x + 1];
+    dx[x] = short(right - left);
+    dy[x] = short(bottom - top);
+}
+
+#if defined(__AVX2__)
+inline __m256i load16(const unsigned char *p)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p));
+}
+
+inline __m256i smooth16(const unsigned char *above, const unsigned char *row,
+                        const unsigned char *below)
+{
+    __m256i r = load16(row);
+    return _mm256_add_epi16(_mm256_add_epi16(load16(above), load16(below)),
+                            _mm256_add_epi16(r, r));
+}
+
+inline __m256i diff16(const unsigned char *above, const unsigned char *below)
+{
+    return _mm256_sub_epi16(load16(below), load16(above));
+}
+#elif defined(__SSE2__)
+inline __m128i load8(const unsigned char *p)
+{
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p),
+                             _mm_setzero_si128());
+}
+
+inline __m128i smooth8(const unsigned char *above, const unsigned char *row,
+                       const unsigned char *below)
+{
+    __m128i r = load8(row);
+    return _mm_add_epi16(_mm_add_epi16(load8(above), load8(below)),
+                         _mm_add_epi16(r, r));
+}
+
+inline __m128i diff8(const unsigned char *above, const unsigned char *below)
+{
+    return _mm_sub_epi16(load8(below), load8(above));
+}
+#endif
+
+#if defined(__AVX2__)
+inline __m256i orientation16(__m256i dx, __m256i dy)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i ax = _mm256_abs_epi16(dx);
+    __m256i ay = _mm256_abs_epi16(dy);
+    __m256i dxNeg = _mm256_cmpgt_epi16(zero, dx);
+    __m256i dxPos = _mm256_cmpgt_epi16(dx, zero);
+    __m256i dyNeg = _mm256_cmpgt_epi16(zero, dy);
+    __m256i dyPos = _mm256_cmpgt_epi16(dy, zero);
+    __m256i dxZero = _mm256_cmpeq_epi16(dx, zero);
+    __m256i dyZero = _mm256_cmpeq_epi16(dy, zero);
+
+    __m256i lower = _mm256_or_si256(dxNeg, _mm256_and_si256(dxZero, dyNeg));
+    __m256i odd = _mm256_or_si256(_mm256_andnot_si256(dyPos, dxPos),
+                                  _mm256_andnot_si256(dyNeg, dxNeg));
+    __m256i axLt = _mm256_cmpgt_epi16(ay, ax);
+    __m256i ayLt = _mm256_cmpgt_epi16(ax, ay);
+    // odd quadrants take |dy| >= |dx|, even ones |dx| >= |dy|
+    __m256i half = _mm256_andnot_si256(_mm256_or_si256(_mm256_and_si256(odd, ayLt),
+                                                       _mm256_andnot_si256(odd, axLt)),
+                                       _mm256_set1_epi16(-1));
+    half = _mm256_andnot_si256(_mm256_and_si256(dxZero, dyZero), half);
+
+    return _mm256_or_si256(_mm256_or_si256(
+                               _mm256_and_si256(lower, _mm256_set1_epi16(4)),
+                               _mm256_and_si256(odd, _mm256_set1_epi16(2))),
+                           _mm256_and_si256(half, _mm256_set1_epi16(1)));
+}
+#elif defined(__SSE2__)
+inline __m128i orientation8(__m128i dx, __m128i dy)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i ax = _mm_max_epi16(dx, _mm_sub_epi16(zero, dx));
+    __m128i ay = _mm_max_epi16(dy, _mm_sub_epi16(zero, dy));
+    __m128i dxNeg = _mm_cmplt_epi16(dx, zero);
+    __m128i dxPos = _mm_cmpgt_epi16(dx, zero);
+    __m128i dyNeg = _mm_cmplt_epi16(dy, zero);
+    __m128i dyPos = _mm_cmpgt_epi16(dy, zero);
+    __m128i dxZero = _mm_cmpeq_epi16(dx, zero);
+    __m128i dyZero = _mm_cmpeq_epi16(dy, zero);
+
+    __m128i lower = _mm_or_si128(dxNeg, _mm_and_si128(dxZero, dyNeg));
+    __m128i odd = _mm_or_si128(_mm_andnot_si128(dyPos, dxPos),
+                               _mm_andnot_si128(dyNeg, dxNeg));
+    __m128i axLt = _mm_cmplt_epi16(ax, ay);
+    __m128i ayLt = _mm_cmplt_epi16(ay, ax);
+    // odd quadrants take |dy| >= |dx|, even ones |dx| >= |dy|
+    __m128i half = _mm_andnot_si128(_mm_or_si128(_mm_and_si128(odd, ayLt),
+                                                 _mm_andnot_si128(odd, axLt)),
+                                    _mm_set1_epi16(-1));
+    half = _mm_andnot_si128(_mm_and_si128(dxZero, dyZero), half);
+
+    return _mm_or_si128(_mm_or_si128(_mm_and_si128(lower, _mm_set1_epi16(4)),
+                                     _mm_and_si128(odd, _mm_set1_epi16(2))),
+                        _mm_and_si128(half, _mm_set1_epi16(1)));
+}
+#endif
+
+} // namespace
+
+int Gradient::orientationBinReference(double dx, double dy)
+{
+    double direction = std::atan2(dx, dy);
+    if (dx < 0)
+    {
+        direction += 2 * M_PI;
+    }
+    return int(std::floor(direction * 4 / M_PI));
+}
+
+void Gradient::orientationRow(const short *dx, const short *dy, int width,
+                              unsigned char *bins)
+{
+    int x = 0;
+#if defined(__AVX2__)
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i bin = orientation16(_mm256_loadu_si256((const __m256i *)(dx + x)),
+                                    _mm256_loadu_si256((const __m256i *)(dy + x)));
+        __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(bin),
+                                          _mm256_extracti128_si256(bin, 1));
+        _mm_storeu_si128((__m128i *)(bins + x), packed);
+    }
+#elif defined(__SSE2__)
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i bin = orientation8(_mm_loadu_si128((const __m128i *)(dx + x)),
+                                   _mm_loadu_si128((const __m128i *)(dy + x)));
+        _mm_storel_epi64((__m128i *)(bins + x), _mm_packus_epi16(bin, bin));
+    }
+#endif
+    for (; x < width; ++x)
+    {
+        bins[x] = (unsigned char)orientationBin(dx[x], dy[x]);
+    }
+}
+
+void Gradient::sobelRowScalar(const unsigned char *above,
+                              const unsigned char *row,
+                              const unsigned char *below, int width,
+                              short *dx, short *dy)
+{
+    if (width <= 0)
+        return;
+    dx[0] = dy[0] = 0;
+    dx[width - 1] = dy[width - 1] = 0;
+    for (int x = 1; x < width - 1; ++x)
+    {
+        sobelPixel(above, row, below, x, dx, dy);
+    }
+}
+
+void Gradient::sobelRow(const unsigned char *above, const unsigned char *row,
+                        const unsigned char *below, int width,
+                        short *dx, short *dy)
+{
+    if (width <= 0)
+        return;
+    dx[0] = dy[0] = 0;
+    dx[width - 1] = dy[width - 1] = 0;
+
+    int x = 1;
+#if defined(__AVX2__)
+    for (; x + 17 <= width; x += 16)
+    {
+        __m256i gx = _mm256_sub_epi16(smooth16(above + x + 1, row + x + 1, below + x + 1),
+                                      smooth16(above + x - 1, row + x - 1, below + x - 1));
+        __m256i c = diff16(above + x, below + x);
+        __m256i gy = _mm256_add_epi16(_mm256_add_epi16(diff16(above + x - 1, below + x - 1),
+                                                       diff16(above + x + 1, below + x + 1)),
+                                      _mm256_add_epi16(c, c));
+        _mm256_storeu_si256((__m256i *)(dx + x), gx);
+        _mm256_storeu_si256((__m256i *)(dy + x), gy);
+    }
+#elif defined(__SSE2__)
+    for (; x + 9 <= width; x += 8)
+    {
+        __m128i gx = _mm_sub_epi16(smooth8(above + x + 1, row + x + 1, below + x + 1),
+                                   smooth8(above + x - 1, row + x - 1, below + x - 1));
+        __m128i c = diff8(above + x, below + x);
+        __m128i gy = _mm_add_epi16(_mm_add_epi16(diff8(above + x - 1, below + x - 1),
+                                                 diff8(above + x + 1, below + x + 1)),
+                                   _mm_add_epi16(c, c));
+        _mm_storeu_si128((__m128i *)(dx + x), gx);
+        _mm_storeu_si128((__m128i *)(dy + x), gy);
+    }
+#endif
+    for (; x < width - 1; ++x)
+    {
+        sobelPixel(above, row, below, x, dx, dy);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef GRADIENT_H
+#define GRADIENT_H
+
+/* Gradient stage of the HOG pipeline.
+
+   Works on one contiguous row-major grayscale plane (stride == width).
+   The Sobel operator is applied separably: a vertical [1 2 1] smoothing
+   followed by a horizontal [-1 0 1] difference gives dx, a vertical
+   [-1 0 1] difference followed by a horizontal [1 2 1] smoothing gives dy.
+   With 8-bit input both fit into 16 bits exactly, so SIMD and scalar
+   paths produce identical results.
+
+   Orientation is quantized into 8 signed bins of pi/4 each, measured as
+   atan2(dx, dy) in [0, 2*pi). The bin depends only on the signs of dx, dy
+   and on how |dx| compares with |dy|, so no trigonometry is needed.
+*/
+namespace Gradient
+{
+    // Reference implementation. Fills dx[x], dy[x] for x in [1, width - 2],
+    // border columns are set to zero.
+    void sobelRowScalar(const unsigned char *above, const unsigned char *row,
+                        const unsigned char *below, int width,
+                        short *dx, short *dy);
+
+    // Same as sobelRowScalar, vectorized with AVX2/SSE2 when the compiler
+    // targets them.
+    void sobelRow(const unsigned char *above, const unsigned char *row,
+                  const unsigned char *below, int width,
+                  short *dx, short *dy);
+
+    // Reference orientation bin computed through atan2.
+    int orientationBinReference(double dx, double dy);
+
+    // Octant bin of (dx, dy), identical to orientationBinReference for
+    // integer gradients.
+    inline int orientationBin(int dx, int dy)
+    {
+        int ax = dx < 0 ? -dx : dx;
+        int ay = dy < 0 ? -dy : dy;
+        // Half-open quadrants: [0, pi/2), [pi/2, pi), [pi, 3pi/2), [3pi/2, 2pi)
+        int lower = (dx < 0) | ((dx == 0) & (dy < 0));
+        int odd = ((dx > 0) & (dy <= 0)) | ((dx < 0) & (dy >= 0));
+        int half = odd ? (ay >= ax) : (ax >= ay);
+        int bin = (lower << 2) | (odd << 1) | half;
+        return ((dx | dy) != 0) ? bin : 0;
+    }
+
+    // Orientation bins for a row of gradients, bins[x] for x in [0, width).
+    void orientationRow(const short *dx, const short *dy, int width,
+                        unsigned char *bins);
+}
+
+#endif // GRADIENT_H
@@ -0,0 +1,132 @@
+#include "grayscale.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+#if defined(__SSE2__) || defined(__AVX2__)
+// Luma of 4 pixels given as 0xAARRGGBB, result in the low byte of each lane
+inline __m128i luma4(__m128i pixels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    // Byte order in memory is B, G, R, A
+    const __m128i weights = _mm_setr_epi16(721, 7154, 2125, 0, 721, 7154, 2125, 0);
+    __m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);
+    __m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights);
+    // low = [b0g0, r0, b1g1, r1], high = [b2g2, r2, b3g3, r3]
+    __m128 lowPs = _mm_castsi128_ps(low);
+    __m128 highPs = _mm_castsi128_ps(high);
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(lowPs, highPs, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i odd = _mm_castps_si128(_mm_shuffle_ps(lowPs, highPs, _MM_SHUFFLE(3, 1, 3, 1)));
+    __m128i sum = _mm_add_epi32(even, odd);
+
+    // sum / 10000 through the 2^45 reciprocal, two lanes per multiply
+    const __m128i reciprocal = _mm_set1_epi32(int(3518437209u));
+    __m128i q02 = _mm_srli_epi64(_mm_mul_epu32(sum, reciprocal), 45);
+    __m128i q13 = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(sum, 32), reciprocal), 45);
+    return _mm_or_si128(q02, _mm_slli_epi64(q13, 32));
+}
+#endif
+
+} // namespace
+
+void Grayscale::lumaRowRgb32(const QRgb *row, int width, uchar *gray)
+{
+    int x = 0;
+#if defined(__SSE2__) || defined(__AVX2__)
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i first = luma4(_mm_loadu_si128((const __m128i *)(row + x)));
+        __m128i second = luma4(_mm_loadu_si128((const __m128i *)(row + x + 4)));
+        __m128i words = _mm_packs_epi32(first, second);
+        _mm_storel_epi64((__m128i *)(gray + x), _mm_packus_epi16(words, words));
+    }
+#endif
+    for (; x < width; ++x)
+    {
+        QRgb rgb = row[x];
+        gray[x] = uchar(luma(qRed(rgb), qGreen(rgb), qBlue(rgb)));
+    }
+}
+
+void Grayscale::lumaRowRgb888(const uchar *row, int width, uchar *gray)
+{
+    for (int x = 0; x < width; ++x, row += 3)
+    {
+        gray[x] = uchar(luma(row[0], row[1], row[2]));
+    }
+}
+
+void Grayscale::lumaRowIndexed8(const uchar *row, int width,
+                                const uchar *table, uchar *gray)
+{
+    for (int x = 0; x < width; ++x)
+    {
+        gray[x] = table[row[x]];
+    }
+}
+
+Grayscale::Reader::Reader(const QImage &image)
+    : m_image(image), m_kind(RGB32)
+{
+    switch (m_image.format())
+    {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        m_kind = RGB32;
+        break;
+    case QImage::Format_RGB888:
+        m_kind = RGB888;
+        break;
+    case QImage::Format_Indexed8:
+    {
+        QVector<QRgb> colors = m_image.colorTable();
+        bool identity = colors.size() == 256;
+        for (int i = 0; i < 256; ++i)
+        {
+            QRgb rgb = i < colors.size() ? colors[i] : 0;
+            m_table[i] = uchar(luma(qRed(rgb), qGreen(rgb), qBlue(rgb)));
+            identity = identity && rgb == qRgb(i, i, i);
+        }
+        m_kind = identity ? GRAY : INDEXED8;
+        break;
+    }
+#if QT_VERSION >= 0x050500
+    case QImage::Format_Grayscale8:
+        m_kind = GRAY;
+        break;
+#endif
+    default:
+        // Rare formats (mono, 16-bit, ...) go through one full conversion
+        if (!m_image.isNull())
+            m_image = m_image.convertToFormat(QImage::Format_RGB32);
+        m_kind = RGB32;
+        break;
+    }
+}
+
+const uchar *Grayscale::Reader::row(int y, uchar *buffer) const
+{
+    const uchar *line = m_image.constScanLine(y);
+    switch (m_kind)
+    {
+    case GRAY:
+        return line;
+    case RGB888:
+        lumaRowRgb888(line, width(), buffer);
+        break;
+    case INDEXED8:
+        lumaRowIndexed8(line, width(), m_table, buffer);
+        break;
+    default:
+        lumaRowRgb32((const QRgb *)line, width(), buffer);
+        break;
+    }
+    return buffer;
+}
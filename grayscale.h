@@ -0,0 +1,62 @@
+#ifndef GRAYSCALE_H
+#define GRAYSCALE_H
+
+#include <QImage>
+#include <QVector>
+
+/* Fixed-point luma conversion for the gradient stage.
+
+   gray = floor((2125 * R + 7154 * G + 721 * B) / 10000), i.e. the
+   0.2125 / 0.7154 / 0.0721 weights evaluated exactly in integers. The
+   quotient is taken with a multiply by the 2^45 / 10000 reciprocal, which
+   is exact for every 8-bit input.
+*/
+namespace Grayscale
+{
+    inline int luma(int red, int green, int blue)
+    {
+        unsigned int sum = 2125 * red + 7154 * green + 721 * blue;
+        return int((sum * quint64(3518437209u)) >> 45);
+    }
+
+    // Kernels for one row of pixels. Rgb32 covers RGB32, ARGB32 and
+    // ARGB32_Premultiplied (alpha is ignored); Rgb888 reads R, G, B bytes;
+    // Indexed8 maps through a 256-entry table of palette lumas.
+    void lumaRowRgb32(const QRgb *row, int width, uchar *gray);
+    void lumaRowRgb888(const uchar *row, int width, uchar *gray);
+    void lumaRowIndexed8(const uchar *row, int width, const uchar *table,
+                         uchar *gray);
+
+    /* Row-by-row 8-bit grayscale view of an image.
+
+       Indexed8 images with an identity gray palette (and Grayscale8 with
+       Qt >= 5.5) are read in place through their scanlines, other rows are
+       converted on request, so no full-size gray copy is ever made.
+    */
+    class Reader
+    {
+    public:
+        explicit Reader(const QImage &image);
+
+        int width() const { return m_image.width(); }
+        int height() const { return m_image.height(); }
+        // Gray row y, either a scanline of the image or 'buffer' (width
+        // bytes) filled with the converted row
+        const uchar *row(int y, uchar *buffer) const;
+
+    private:
+        enum Kind
+        {
+            GRAY,
+            RGB32,
+            RGB888,
+            INDEXED8
+        };
+
+        QImage m_image;
+        Kind m_kind;
+        uchar m_table[256];
+    };
+}
+
+#endif // GRAYSCALE_H
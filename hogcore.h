@@ -0,0 +1,180 @@
+#ifndef HOGCORE_H
+#define HOGCORE_H
+
+#include <QVector>
+
+#ifdef DETECTOR_SINGLE_PRECISION
+typedef float HogFeature;
+#else
+typedef double HogFeature;
+#endif
+
+typedef QVector<HogFeature> HogCell;
+typedef QVector<QVector<HogCell> > HogCells;
+
+/* Compile-time description of a HOG window: cell side in pixels, block side
+   in cells, number of orientation bins and window size in cells.
+*/
+template <int CellSize, int BlockSize, int Bins, int WinWidthCell, int WinHeightCell>
+struct HogGeometry
+{
+    enum
+    {
+        CELL_SIZE = CellSize,
+        BLOCK_SIZE = BlockSize,
+        BINS = Bins,
+
+        WIN_WIDTH_CELL = WinWidthCell,
+        WIN_HEIGHT_CELL = WinHeightCell,
+        WIN_WIDTH = WinWidthCell * CellSize,
+        WIN_HEIGHT = WinHeightCell * CellSize,
+        WIN_BLOCKS_X = WinWidthCell - BlockSize + 1,
+        WIN_BLOCKS_Y = WinHeightCell - BlockSize + 1,
+
+        BLOCK_FEATURES = BlockSize * BlockSize * Bins,
+        BLOCK_PIXELS = BlockSize * BlockSize * CellSize * CellSize,
+        DESCRIPTOR_LENGTH = WIN_BLOCKS_Y * WIN_BLOCKS_X * BLOCK_FEATURES
+    };
+};
+
+/* Detector kernels specialized on a HogGeometry. All loop bounds are
+   compile-time constants, so block normalization and the linear window
+   dot product can be fully unrolled and vectorized.
+*/
+template <class Geometry>
+struct HogCore
+{
+    enum { ROW_LENGTH = Geometry::WIN_BLOCKS_X * Geometry::BLOCK_FEATURES };
+
+    // Descriptor of one window, stored inline so it can live on the stack
+    struct Descriptor
+    {
+        Q_DECL_ALIGN(16) HogFeature values[Geometry::DESCRIPTOR_LENGTH];
+    };
+
+    // Every bin of every cell of the block divided by the block total of
+    // that bin, cells in row-major order.
+    static void computeBlock(const HogCells &cells, int y, int x,
+                             HogFeature *block)
+    {
+        const HogFeature *blockCells[Geometry::BLOCK_SIZE * Geometry::BLOCK_SIZE];
+        for (int i = 0; i < Geometry::BLOCK_SIZE; ++i)
+        {
+            for (int j = 0; j < Geometry::BLOCK_SIZE; ++j)
+            {
+                blockCells[i * Geometry::BLOCK_SIZE + j] = cells[y + i][x + j].constData();
+            }
+        }
+        normalizeBlock(blockCells, block);
+    }
+
+    // Same as computeBlock() for the histograms of the block cells given
+    // in row-major order, wherever they are stored
+    static void normalizeBlock(const HogFeature *const *blockCells,
+                               HogFeature *block)
+    {
+        double localCell[Geometry::BINS];
+        for (int k = 0; k < Geometry::BINS; ++k)
+        {
+            localCell[k] = 0;
+        }
+        for (int c = 0; c < Geometry::BLOCK_SIZE * Geometry::BLOCK_SIZE; ++c)
+        {
+            for (int k = 0; k < Geometry::BINS; ++k)
+            {
+                localCell[k] += blockCells[c][k];
+            }
+        }
+        for (int c = 0; c < Geometry::BLOCK_SIZE * Geometry::BLOCK_SIZE; ++c)
+        {
+            for (int k = 0; k < Geometry::BINS; ++k)
+            {
+                *block++ = localCell[k] == 0 ? 0 : HogFeature(blockCells[c][k] / localCell[k]);
+            }
+        }
+    }
+
+    static void computeDescriptor(const HogCells &cells, int shift,
+                                  HogFeature *descriptor)
+    {
+        for (int y = 0; y < Geometry::WIN_BLOCKS_Y; ++y)
+        {
+            for (int x = 0; x < Geometry::WIN_BLOCKS_X; ++x)
+            {
+                computeBlock(cells, y, x + shift, descriptor);
+                descriptor += Geometry::BLOCK_FEATURES;
+            }
+        }
+    }
+
+    // Linear score of the window at cell column 'shift', its descriptor
+    // built on the stack
+    static double scoreWindow(const HogCells &cells, int shift,
+                              const HogFeature *w)
+    {
+        Descriptor descriptor;
+        computeDescriptor(cells, shift, descriptor.values);
+        const HogFeature *values = descriptor.values;
+        HogFeature sums[4] = { 0, 0, 0, 0 };
+        int k = 0;
+        for (; k + 4 <= Geometry::DESCRIPTOR_LENGTH; k += 4)
+        {
+            sums[0] += w[k] * values[k];
+            sums[1] += w[k + 1] * values[k + 1];
+            sums[2] += w[k + 2] * values[k + 2];
+            sums[3] += w[k + 3] * values[k + 3];
+        }
+        for (; k < Geometry::DESCRIPTOR_LENGTH; ++k)
+        {
+            sums[0] += w[k] * values[k];
+        }
+        return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    }
+
+    /* Linear scores of the first 'windows' windows of a plane, one pass
+       over its blocks. Block (y, X) contributes its dot product with the
+       weight slice (y, x) to the window at shift X - x, so every block is
+       read once per plane row instead of once per covering window.
+    */
+    static void scoreWindows(const HogFeature *plane, int cols, int windows,
+                             const HogFeature *w, double *scores)
+    {
+        for (int i = 0; i < windows; ++i)
+        {
+            scores[i] = 0;
+        }
+        for (int y = 0; y < Geometry::WIN_BLOCKS_Y; ++y)
+        {
+            const HogFeature *row = plane + y * cols * Geometry::BLOCK_FEATURES;
+            const HogFeature *rowWeights = w + y * ROW_LENGTH;
+            const int lastColumn = qMin(cols, windows + Geometry::WIN_BLOCKS_X - 1);
+            for (int column = 0; column < lastColumn; ++column)
+            {
+                const HogFeature *block = row + column * Geometry::BLOCK_FEATURES;
+                const int first = qMax(0, column - windows + 1);
+                const int last = qMin(int(Geometry::WIN_BLOCKS_X) - 1, column);
+                for (int x = first; x <= last; ++x)
+                {
+                    // Four independent sums, a single one waits on every add
+                    const HogFeature *blockWeights = rowWeights + x * Geometry::BLOCK_FEATURES;
+                    HogFeature sums[4] = { 0, 0, 0, 0 };
+                    int k = 0;
+                    for (; k + 4 <= Geometry::BLOCK_FEATURES; k += 4)
+                    {
+                        sums[0] += blockWeights[k] * block[k];
+                        sums[1] += blockWeights[k + 1] * block[k + 1];
+                        sums[2] += blockWeights[k + 2] * block[k + 2];
+                        sums[3] += blockWeights[k + 3] * block[k + 3];
+                    }
+                    for (; k < Geometry::BLOCK_FEATURES; ++k)
+                    {
+                        sums[0] += blockWeights[k] * block[k];
+                    }
+                    scores[column - x] += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+                }
+            }
+        }
+    }
+};
+
+#endif // HOGCORE_H
@@ -0,0 +1,275 @@
+#include "imagepipeline.h"
+#include <QThread>
+#include <QElapsedTimer>
+
+class ImagePipeline::Thread : public QThread
+{
+public:
+    enum Stage { DECODE, SCORE };
+
+    Thread(ImagePipeline *pipeline, Stage stage, int worker)
+        : m_pipeline(pipeline), m_stage(stage), m_worker(worker)
+    {
+    }
+
+    // QThread::usleep() is protected in Qt 4
+    static void pause(unsigned long usecs)
+    {
+        QThread::usleep(usecs);
+    }
+
+protected:
+    void run()
+    {
+        if (m_stage == DECODE)
+        {
+            m_pipeline->decodeLoop(m_worker);
+        } else {
+            m_pipeline->scoreLoop(m_worker);
+        }
+    }
+
+private:
+    ImagePipeline *m_pipeline;
+    Stage m_stage;
+    int m_worker;
+};
+
+ImagePipeline::ThreadStats::ThreadStats()
+    : busyNsecs(0), waitNsecs(0), peakDepth(0), depthSum(0), pushes(0)
+{
+}
+
+ImagePipeline::ImagePipeline(int decoders, int scorers, int depth)
+    : m_decoders(decoders > 0 ? decoders : qMax(QThread::idealThreadCount(), 1)),
+      m_scorers(scorers > 0 ? scorers : qMax(QThread::idealThreadCount(), 1)),
+      m_decoded(qMax(depth, 1)),
+      m_scored(qMax(depth, 1)),
+      m_job(NULL),
+      m_count(0)
+{
+}
+
+int ImagePipeline::decoders() const
+{
+    return m_decoders;
+}
+
+int ImagePipeline::scorers() const
+{
+    return m_scorers;
+}
+
+int ImagePipeline::window() const
+{
+    // Enough to keep every thread and queue slot busy
+    return m_decoders + m_decoded.capacity() + m_scorers + m_scored.capacity();
+}
+
+void ImagePipeline::run(Job &job, int count)
+{
+    m_job = &job;
+    m_count = qMax(count, 0);
+    m_nextDecode.fetchAndStoreOrdered(0);
+    m_nextScore.fetchAndStoreOrdered(0);
+    m_written.fetchAndStoreOrdered(0);
+    m_decodeStats = QVector<ThreadStats>(m_decoders);
+    m_scoreStats = QVector<ThreadStats>(m_scorers);
+    m_writeStats = ThreadStats();
+
+    QVector<Thread *> threads;
+    for (int w = 0; w < qMin(m_decoders, m_count); ++w)
+    {
+        threads.push_back(new Thread(this, Thread::DECODE, w));
+        threads.last()->start();
+    }
+    for (int w = 0; w < qMin(m_scorers, m_count); ++w)
+    {
+        threads.push_back(new Thread(this, Thread::SCORE, w));
+        threads.last()->start();
+    }
+    writeLoop();
+    for (int i = 0; i < threads.size(); ++i)
+    {
+        threads[i]->wait();
+        delete threads[i];
+    }
+    m_job = NULL;
+}
+
+void ImagePipeline::decodeLoop(int worker)
+{
+    ThreadStats &stats = m_decodeStats[worker];
+    QElapsedTimer timer;
+    for (;;)
+    {
+        const int index = m_nextDecode.fetchAndAddOrdered(1);
+        if (index >= m_count)
+            break;
+
+        // Backpressure: stay within the window ahead of the writer
+        timer.start();
+        int spins = 0;
+        while (index >= m_written.fetchAndAddAcquire(0) + window())
+        {
+            backOff(spins);
+        }
+        stats.waitNsecs += timer.nsecsElapsed();
+
+        timer.start();
+        Decoded decoded;
+        decoded.index = index;
+        decoded.image = m_job->decode(index);
+        stats.busyNsecs += timer.nsecsElapsed();
+
+        timer.start();
+        spins = 0;
+        while (!m_decoded.tryPush(decoded))
+        {
+            backOff(spins);
+        }
+        stats.waitNsecs += timer.nsecsElapsed();
+        sampleDepth(stats, m_decoded.size());
+    }
+}
+
+void ImagePipeline::scoreLoop(int worker)
+{
+    ThreadStats &stats = m_scoreStats[worker];
+    QElapsedTimer timer;
+    // Every index is pushed once, so claiming one guarantees a pop
+    while (m_nextScore.fetchAndAddOrdered(1) < m_count)
+    {
+        timer.start();
+        Decoded decoded;
+        int spins = 0;
+        while (!m_decoded.tryPop(&decoded))
+        {
+            backOff(spins);
+        }
+        stats.waitNsecs += timer.nsecsElapsed();
+
+        timer.start();
+        m_job->score(decoded.index, decoded.image, worker);
+        const int index = decoded.index;
+        // The image is not needed any more, release it before waiting
+        decoded.image = QImage();
+        stats.busyNsecs += timer.nsecsElapsed();
+
+        timer.start();
+        spins = 0;
+        while (!m_scored.tryPush(index))
+        {
+            backOff(spins);
+        }
+        stats.waitNsecs += timer.nsecsElapsed();
+        sampleDepth(stats, m_scored.size());
+    }
+}
+
+void ImagePipeline::writeLoop()
+{
+    ThreadStats &stats = m_writeStats;
+    QElapsedTimer timer;
+    // Scored indices not written yet, by index modulo the window; no index
+    // is scored a full window ahead of the next to write
+    QVector<bool> done(window(), false);
+    int written = 0;
+    while (written < m_count)
+    {
+        timer.start();
+        int index = 0;
+        int spins = 0;
+        while (!m_scored.tryPop(&index))
+        {
+            backOff(spins);
+        }
+        stats.waitNsecs += timer.nsecsElapsed();
+
+        timer.start();
+        done[index % done.size()] = true;
+        for (; written < m_count && done[written % done.size()]; ++written)
+        {
+            done[written % done.size()] = false;
+            m_job->write(written);
+            m_written.fetchAndStoreRelease(written + 1);
+        }
+        stats.busyNsecs += timer.nsecsElapsed();
+    }
+}
+
+ImagePipeline::StageStats ImagePipeline::decodeStats() const
+{
+    return stageStats(m_decodeStats);
+}
+
+ImagePipeline::StageStats ImagePipeline::scoreStats() const
+{
+    return stageStats(m_scoreStats);
+}
+
+ImagePipeline::StageStats ImagePipeline::writeStats() const
+{
+    return stageStats(QVector<ThreadStats>(1, m_writeStats));
+}
+
+ImagePipeline::QueueStats ImagePipeline::decodedQueueStats() const
+{
+    return queueStats(m_decodeStats, m_decoded.capacity());
+}
+
+ImagePipeline::QueueStats ImagePipeline::scoredQueueStats() const
+{
+    return queueStats(m_scoreStats, m_scored.capacity());
+}
+
+ImagePipeline::StageStats ImagePipeline::stageStats(const QVector<ThreadStats> &threads) const
+{
+    StageStats stage;
+    stage.threads = threads.size();
+    qint64 busy = 0;
+    qint64 wait = 0;
+    for (int i = 0; i < threads.size(); ++i)
+    {
+        busy += threads[i].busyNsecs;
+        wait += threads[i].waitNsecs;
+    }
+    stage.busyMsecs = busy / 1000000;
+    stage.waitMsecs = wait / 1000000;
+    return stage;
+}
+
+ImagePipeline::QueueStats ImagePipeline::queueStats(const QVector<ThreadStats> &threads,
+                                                    int capacity) const
+{
+    QueueStats queue;
+    queue.capacity = capacity;
+    queue.peakDepth = 0;
+    qint64 depthSum = 0;
+    int pushes = 0;
+    for (int i = 0; i < threads.size(); ++i)
+    {
+        queue.peakDepth = qMax(queue.peakDepth, threads[i].peakDepth);
+        depthSum += threads[i].depthSum;
+        pushes += threads[i].pushes;
+    }
+    queue.meanDepth = pushes > 0 ? double(depthSum) / pushes : 0.0;
+    return queue;
+}
+
+void ImagePipeline::sampleDepth(ThreadStats &stats, int depth)
+{
+    stats.peakDepth = qMax(stats.peakDepth, depth);
+    stats.depthSum += depth;
+    ++stats.pushes;
+}
+
+void ImagePipeline::backOff(int &spins)
+{
+    if (++spins < YIELDS)
+    {
+        QThread::yieldCurrentThread();
+    } else {
+        Thread::pause(qMin((spins - YIELDS + 1) * PAUSE_USECS, int(MAX_PAUSE_USECS)));
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef IMAGEPIPELINE_H
+#define IMAGEPIPELINE_H
+
+#include <QImage>
+#include <QVector>
+#include <QAtomicInt>
+#include "boundedqueue.h"
+
+/* Runs a job over a range of images in three stages: a pool of decode
+   threads, a pool of scoring threads and a single writer, the calling
+   thread. Stages hand images on through BoundedQueues, so decoding the
+   next images overlaps scoring the current ones.
+
+   Decoders take images in index order and the writer gets them back in
+   index order. No decoder starts on an image more than window() images
+   ahead of the writer, which bounds both the decoded images in flight
+   and the results the job has to keep until they are written.
+*/
+class ImagePipeline
+{
+public:
+    class Job
+    {
+    public:
+        virtual ~Job() {}
+        // Called once for every index, from any decode thread
+        virtual QImage decode(int index) = 0;
+        // Called once for every index with its decoded image, by scoring
+        // thread 'worker' < scorers()
+        virtual void score(int index, const QImage &image, int worker) = 0;
+        // Called once for every index in increasing order, from the thread
+        // calling run(), after score() returned for that index
+        virtual void write(int index) = 0;
+    };
+
+    // Time one stage spent over the last run(), summed over its threads
+    struct StageStats
+    {
+        int threads;
+        // In the job
+        qint64 busyMsecs;
+        // Waiting for a full queue to drain or an empty one to fill
+        qint64 waitMsecs;
+    };
+
+    // Depth of one queue sampled at every push of the last run()
+    struct QueueStats
+    {
+        int capacity;
+        int peakDepth;
+        double meanDepth;
+    };
+
+    // 0 decoders or scorers means one per core; 'depth' is the capacity of
+    // each queue
+    ImagePipeline(int decoders, int scorers, int depth);
+
+    int decoders() const;
+    int scorers() const;
+    // Most images between the next to write and the last taken by a decoder
+    int window() const;
+    // Returns when write() returned for every index in [0, count)
+    void run(Job &job, int count);
+
+    StageStats decodeStats() const;
+    StageStats scoreStats() const;
+    StageStats writeStats() const;
+    // Decoded images waiting for a scoring thread
+    QueueStats decodedQueueStats() const;
+    // Scored indices waiting for the writer
+    QueueStats scoredQueueStats() const;
+
+private:
+    Q_DISABLE_COPY(ImagePipeline)
+
+    enum
+    {
+        // Tries before a waiting thread starts sleeping, and its sleeps
+        // growing from PAUSE_USECS to MAX_PAUSE_USECS
+        YIELDS = 16,
+        PAUSE_USECS = 50,
+        MAX_PAUSE_USECS = 1000
+    };
+
+    class Thread;
+    struct Decoded
+    {
+        int index;
+        QImage image;
+    };
+    // Counters of one thread, summed once the threads are done
+    struct ThreadStats
+    {
+        ThreadStats();
+        qint64 busyNsecs;
+        qint64 waitNsecs;
+        int peakDepth;
+        qint64 depthSum;
+        int pushes;
+    };
+
+    void decodeLoop(int worker);
+    void scoreLoop(int worker);
+    void writeLoop();
+    StageStats stageStats(const QVector<ThreadStats> &threads) const;
+    QueueStats queueStats(const QVector<ThreadStats> &threads,
+                          int capacity) const;
+    static void sampleDepth(ThreadStats &stats, int depth);
+    // Yields for a while, then sleeps longer and longer, so long waits do
+    // not spin a core
+    static void backOff(int &spins);
+
+    int m_decoders;
+    int m_scorers;
+    BoundedQueue<Decoded> m_decoded;
+    BoundedQueue<int> m_scored;
+    Job *m_job;
+    int m_count;
+    // Next index for a decoder, indices handed to scorers, indices written
+    QAtomicInt m_nextDecode;
+    QAtomicInt m_nextScore;
+    QAtomicInt m_written;
+    QVector<ThreadStats> m_decodeStats;
+    QVector<ThreadStats> m_scoreStats;
+    ThreadStats m_writeStats;
+};
+
+#endif // IMAGEPIPELINE_H
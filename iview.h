@@ -2,6 +2,7 @@
 #define IVIEW_H
 
 #include <QImage>
+#include "progress.h"
 
 class IView
 {
@@ -11,6 +12,9 @@ public:
     virtual void setViewFScore(double value) = 0;
     virtual void setViewScannedImage(const QImage &image) = 0;
     virtual void showWarning(const QString &warningMsg) = 0;
+    virtual void setViewProgress(const Progress &progress) = 0;
+    // Whether operations are running or waiting, which can be cancelled
+    virtual void setViewBusy(bool busy) = 0;
 
 public: // signals
     virtual void setTrueLocationFileName(const QString &fileName) = 0;
@@ -27,6 +31,7 @@ public: // signals
     virtual void classifyDirectory() = 0;
     virtual void estimateQuality() = 0;
     virtual void scanImage(const QString &fileName) = 0;
+    virtual void cancel() = 0;
 };
 
 #endif // IVIEW_H
@@ -0,0 +1,41 @@
+#include "kernelmap.h"
+#include <QtCore/qmath.h>
+
+namespace
+{
+
+double sech(double x)
+{
+    return 2 * qExp(x) / (1 + qExp(2 * x));
+}
+
+} // namespace
+
+void kernelMap(double value, int n, double L, double *mapped)
+{
+    for (int k = -n; k <= n; ++k)
+    {
+        if (value == 0)
+        {
+            *mapped++ = 0;
+            *mapped++ = 0;
+            continue;
+        }
+        double lambda = k * L;
+        double re = qCos(lambda * qLn(value));
+        double im = -qSin(lambda * qLn(value));
+        double add = qSqrt(value * sech(M_PI * lambda));
+        *mapped++ = re * add;
+        *mapped++ = im * add;
+    }
+}
+
+double kernelMapNorm(int n, double L)
+{
+    double norm = 0;
+    for (int k = -n; k <= n; ++k)
+    {
+        norm += sech(M_PI * k * L);
+    }
+    return norm;
+}
@@ -0,0 +1,12 @@
+#ifndef KERNELMAP_H
+#define KERNELMAP_H
+
+/* Explicit feature map of the additive (chi2-like) kernel used with
+   m_useLinear == false: every value x becomes 2 * (2n + 1) numbers
+   sqrt(x * sech(pi * k * L)) * (cos, -sin)(k * L * ln x), k = -n..n.
+*/
+void kernelMap(double value, int n, double L, double *mapped);
+// Squared norm of the map of 1, the map of x has x times that
+double kernelMapNorm(int n, double L);
+
+#endif // KERNELMAP_H
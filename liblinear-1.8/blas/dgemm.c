@@ -0,0 +1,125 @@
+#include "blas.h"
+
+#define DGEMM_BLOCK 64
+
+int dgemm_(char *transa, char *transb, int *m, int *n, int *k,
+           double *alpha, double *a, int *lda, double *b, int *ldb,
+           double *beta, double *c, int *ldc)
+{
+  long int i, j, l, i0, i1, mm, nn, kk, llda, lldb, lldc;
+  long int ia, ib;
+  int nota, notb;
+  double aalpha, bbeta, stemp, s0, s1, s2, s3;
+  double *ci, *aa, *bb;
+
+  /* performs one of the matrix-matrix operations
+     c := alpha*op( a )*op( b ) + beta*c,
+     where op( x ) is x or x', all matrices column-major,
+     op( a ) an m by k, op( b ) a k by n and c an m by n matrix.
+     rows of c are processed in panels of DGEMM_BLOCK so that the
+     matching panel of a stays in cache while every column of b
+     is swept over it.
+     follows the level 3 blas reference loops,
+     jack dongarra, iain duff, jeremy du croz, sven hammarling, 8/2/89. */
+
+  /* Dereference inputs */
+  mm = *m;
+  nn = *n;
+  kk = *k;
+  llda = *lda;
+  lldb = *ldb;
+  lldc = *ldc;
+  aalpha = *alpha;
+  bbeta = *beta;
+  nota = (*transa == 'N' || *transa == 'n');
+  notb = (*transb == 'N' || *transb == 'n');
+
+  if (mm <= 0 || nn <= 0 || ((aalpha == 0.0 || kk <= 0) && bbeta == 1.0))
+    return 0;
+
+  /* c := beta*c */
+  if (bbeta != 1.0)
+  {
+    for (j = 0; j < nn; j++)
+    {
+      ci = c + j * lldc;
+      if (bbeta == 0.0)
+        for (i = 0; i < mm; i++)
+          ci[i] = 0.0;
+      else
+        for (i = 0; i < mm; i++)
+          ci[i] = bbeta * ci[i];
+    }
+  }
+  if (aalpha == 0.0 || kk <= 0)
+    return 0;
+
+  for (i0 = 0; i0 < mm; i0 += DGEMM_BLOCK)
+  {
+    i1 = MIN(i0 + DGEMM_BLOCK, mm);
+    j = 0;
+    if (!nota && notb) /* four columns of c at a time share each a(:,i) */
+    {
+      for ( ; j + 4 <= nn; j += 4)
+      {
+        for (i = i0; i < i1; i++)
+        {
+          aa = a + i * llda;
+          bb = b + j * lldb;
+          s0 = s1 = s2 = s3 = 0.0;
+          for (l = 0; l < kk; l++)
+          {
+            s0 += aa[l] * bb[l];
+            s1 += aa[l] * bb[l + lldb];
+            s2 += aa[l] * bb[l + 2 * lldb];
+            s3 += aa[l] * bb[l + 3 * lldb];
+          }
+          ci = c + j * lldc + i;
+          ci[0] += aalpha * s0;
+          ci[lldc] += aalpha * s1;
+          ci[2 * lldc] += aalpha * s2;
+          ci[3 * lldc] += aalpha * s3;
+        }
+      }
+    }
+    for ( ; j < nn; j++)
+    {
+      ci = c + j * lldc;
+      if (nota) /* c(i,j) += alpha * sum_l a(i,l) * op( b )(l,j) */
+      {
+        for (l = 0; l < kk; l++)
+        {
+          ib = notb ? l + j * lldb : j + l * lldb;
+          stemp = aalpha * b[ib];
+          if (stemp == 0.0)
+            continue;
+          aa = a + l * llda;
+          for (i = i0; i < i1; i++)
+            ci[i] += stemp * aa[i];
+        }
+      }
+      else /* c(i,j) += alpha * dot( a(:,i), op( b )(:,j) ) */
+      {
+        for (i = i0; i < i1; i++)
+        {
+          aa = a + i * llda;
+          stemp = 0.0;
+          if (notb)
+          {
+            bb = b + j * lldb;
+            for (l = 0; l < kk; l++)
+              stemp += aa[l] * bb[l];
+          }
+          else
+          {
+            for (l = 0, ia = j; l < kk; l++, ia += lldb)
+              stemp += aa[l] * b[ia];
+          }
+          ci[i] += aalpha * stemp;
+        }
+      }
+    }
+  }
+
+  return 0;
+} /* dgemm_ */
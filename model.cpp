@@ -1,13 +1,226 @@
 #include <model.h>
 #include <cstdlib>
+#include <limits>
 #include "liblinear-1.8/linear.h"
+#include "workstealingpool.h"
+#include "imagepipeline.h"
 
-double sech(double x)
+#define Malloc(type,n) (type *)malloc((n)*sizeof(type))
+
+namespace
+{
+
+// Appended to the model file name for the cascade calibration data
+const char cascadeSuffix[] = ".cascade";
+
+// Lines of classifyDirectory() for one image, named without extension
+void writeBoxes(QTextStream &out, const QString &fileName,
+                const QVector<Detection> &detections)
 {
-    return 2 * qExp(x) / (1 + qExp(2 * x));
+    for (int j = 0; j < detections.size(); ++j)
+    {
+        const QRect &box = detections[j].box;
+        out << fileName << ' ' << box.x() << ' ' << box.y() << ' ' <<
+               box.width() << ' ' << box.height() << '\n';
+    }
 }
 
-#define Malloc(type,n) (type *)malloc((n)*sizeof(type))
+void writeShifts(QTextStream &out, const QString &fileName,
+                 const QVector<int> &shifts, const DetectorVariant *variant)
+{
+    for (int j = 0; j < shifts.size(); ++j)
+    {
+        out << fileName << ' ' <<
+               shifts[j] << ' ' <<
+               0 << ' ' << variant->winWidth << ' ' <<
+               variant->winHeight << '\n';
+    }
+}
+
+// Busy and waiting time of every stage and depth of both queues
+void logPipeline(const ImagePipeline &pipeline)
+{
+    const char *names[] = { "decode", "score", "write" };
+    const ImagePipeline::StageStats stages[] =
+    {
+        pipeline.decodeStats(),
+        pipeline.scoreStats(),
+        pipeline.writeStats()
+    };
+    for (int i = 0; i < 3; ++i)
+    {
+        qDebug() << "Stage" << names[i] << "threads:" << stages[i].threads <<
+                    "busy ms:" << stages[i].busyMsecs <<
+                    "waiting ms:" << stages[i].waitMsecs;
+    }
+    const ImagePipeline::QueueStats decoded = pipeline.decodedQueueStats();
+    const ImagePipeline::QueueStats scored = pipeline.scoredQueueStats();
+    qDebug() << "Decoded queue capacity:" << decoded.capacity <<
+                "peak:" << decoded.peakDepth << "mean:" << decoded.meanDepth;
+    qDebug() << "Scored queue capacity:" << scored.capacity <<
+                "peak:" << scored.peakDepth << "mean:" << scored.meanDepth;
+}
+
+/* Detection over a directory by several threads. Every worker has its
+   own context and counters, results are kept per image until written.
+   Once 'progress' is cancelled images are neither decoded nor scanned.
+*/
+class DirectoryDetection
+{
+public:
+    DirectoryDetection(const DetectorEngine &engine, const QString &dirName,
+                       const QStringList &images, QTextStream &out, int workers,
+                       ProgressTracker &progress)
+        : m_engine(engine),
+          m_dirName(dirName),
+          m_images(images),
+          m_out(out),
+          m_progress(progress),
+          m_contexts(workers),
+          m_stats(workers),
+          m_boxes(images.size()),
+          m_shifts(images.size()),
+          m_windows(images.size(), 0),
+          m_written(0),
+          m_writtenWindows(0)
+    {
+        for (int i = 0; i < workers; ++i)
+        {
+            m_contexts[i] = new DetectionContext;
+        }
+    }
+
+    ~DirectoryDetection()
+    {
+        qDeleteAll(m_contexts);
+    }
+
+    QImage decode(int index) const
+    {
+        if (m_progress.isCancelled())
+            return QImage();
+        return QImage(m_dirName + m_images.at(index));
+    }
+
+    void detect(int index, const QImage &image, int worker)
+    {
+        if (m_progress.isCancelled())
+            return;
+        const qint64 windows = m_stats[worker].windows;
+        if (m_engine.detectsBoxes())
+        {
+            m_engine.detectMultiScale(image, *m_contexts[worker], m_boxes[index],
+                                      &m_stats[worker]);
+        } else {
+            m_engine.detect(image, *m_contexts[worker], m_shifts[index],
+                            &m_stats[worker]);
+        }
+        m_windows[index] = m_stats[worker].windows - windows;
+    }
+
+    // Writes the results of an image and frees them; called in image order
+    // and never by two threads at once
+    void write(int index)
+    {
+        QString fileName = m_images.at(index);
+        fileName = fileName.left(fileName.lastIndexOf('.'));
+        writeBoxes(m_out, fileName, m_boxes[index]);
+        writeShifts(m_out, fileName, m_shifts[index], m_engine.variant());
+        m_boxes[index] = QVector<Detection>();
+        m_shifts[index] = QVector<int>();
+        m_writtenWindows += m_windows[index];
+        m_progress.update(++m_written, m_writtenWindows);
+    }
+
+    // Counters of all workers
+    void addStats(DetectionStats &stats) const
+    {
+        for (int i = 0; i < m_stats.size(); ++i)
+        {
+            stats.add(m_stats[i]);
+        }
+    }
+
+private:
+    const DetectorEngine &m_engine;
+    QString m_dirName;
+    QStringList m_images;
+    QTextStream &m_out;
+    ProgressTracker &m_progress;
+    QVector<DetectionContext *> m_contexts;
+    QVector<DetectionStats> m_stats;
+    QVector<QVector<Detection> > m_boxes;
+    QVector<QVector<int> > m_shifts;
+    // Windows scanned per image, summed for the images written
+    QVector<qint64> m_windows;
+    int m_written;
+    qint64 m_writtenWindows;
+};
+
+/* Detection over a directory from a WorkStealingPool. Each worker decodes
+   and detects its own images. Results of an image are written by
+   whichever worker completes the sequence of images before it, so the
+   file comes out in the order of the serial loop.
+*/
+class DirectoryJob : public WorkStealingPool::Job
+{
+public:
+    DirectoryJob(DirectoryDetection &detection, int images)
+        : m_detection(detection),
+          m_done(images, false),
+          m_next(0)
+    {
+    }
+
+    void run(int index, int worker)
+    {
+        m_detection.detect(index, m_detection.decode(index), worker);
+
+        QMutexLocker locker(&m_outMutex);
+        m_done[index] = true;
+        for (; m_next < m_done.size() && m_done[m_next]; ++m_next)
+        {
+            m_detection.write(m_next);
+        }
+    }
+
+private:
+    DirectoryDetection &m_detection;
+    // Images done out of order, m_next is the first not written
+    QVector<bool> m_done;
+    int m_next;
+    QMutex m_outMutex;
+};
+
+// Detection over a directory in the stages of an ImagePipeline
+class PipelineJob : public ImagePipeline::Job
+{
+public:
+    explicit PipelineJob(DirectoryDetection &detection)
+        : m_detection(detection)
+    {
+    }
+
+    QImage decode(int index)
+    {
+        return m_detection.decode(index);
+    }
+
+    void score(int index, const QImage &image, int worker)
+    {
+        m_detection.detect(index, image, worker);
+    }
+
+    void write(int index)
+    {
+        m_detection.write(index);
+    }
+
+private:
+    DirectoryDetection &m_detection;
+};
+
+} // namespace
 
 Model::Model()
 {
@@ -25,6 +238,27 @@ Model::Model()
     m_bound = 0.3;
     m_n = 1;
     m_L = 0.27;
+    m_kernelMapN = -1;
+    m_kernelMapL = 0;
+    m_kernelMapPixels = 0;
+    m_variant = DetectorVariants::defaultVariant();
+    m_useCascade = false;
+    m_cascadeTolerance = 0.01;
+    m_cascadeDirty = true;
+    m_useEarlyTermination = true;
+    m_octaves = 0;
+    m_scalesPerOctave = 4;
+    m_useGridScan = false;
+    m_strideX = 1;
+    m_strideY = 1;
+    m_pixelStrideX = 0;
+    m_pixelStrideY = 0;
+    m_threads = 1;
+    m_decoders = 0;
+    m_batchSize = IMAGES_PER_BATCH;
+    m_classifiedImages = 0;
+    m_monitor = NULL;
+    m_engineDirty = true;
 }
 
 Model::~Model()
@@ -56,11 +290,99 @@ void Model::setDirName(const QString& dirName)
 void Model::setKernel(bool useLinear)
 {
     m_useLinear = useLinear;
+    updateWeights();
+}
+
+bool Model::setVariant(const QString &name)
+{
+    const DetectorVariant *variant = DetectorVariants::byName(name);
+    if (!variant)
+        return false;
+    // Trained or loaded weights only score windows of their own geometry
+    if (m_classifier && variant->descriptorLength *
+            (m_useLinear ? 1 : 2 * (2 * m_n + 1)) != m_featuresNumber)
+    {
+        return false;
+    }
+    m_variant = variant;
+    m_engineDirty = true;
+    return true;
 }
 
 void Model::setBound(double bound)
 {
     m_bound = bound;
+    m_cascadeDirty = true;
+    m_engineDirty = true;
+}
+
+void Model::setCascade(bool useCascade)
+{
+    m_useCascade = useCascade;
+    m_engineDirty = true;
+}
+
+void Model::setCascadeTolerance(double tolerance)
+{
+    m_cascadeTolerance = tolerance;
+    m_cascadeDirty = true;
+    m_engineDirty = true;
+}
+
+void Model::setEarlyTermination(bool useEarlyTermination)
+{
+    m_useEarlyTermination = useEarlyTermination;
+    m_engineDirty = true;
+}
+
+void Model::setPyramid(int octaves, int scalesPerOctave)
+{
+    m_octaves = qMax(octaves, 0);
+    m_scalesPerOctave = qMax(scalesPerOctave, 1);
+    m_engineDirty = true;
+}
+
+void Model::setGridScan(bool useGridScan)
+{
+    m_useGridScan = useGridScan;
+    m_engineDirty = true;
+}
+
+void Model::setStrides(int strideX, int strideY)
+{
+    m_strideX = qMax(strideX, 1);
+    m_strideY = qMax(strideY, 1);
+    m_engineDirty = true;
+}
+
+bool Model::setPixelStrides(int strideX, int strideY)
+{
+    // 0 turns sub-cell strides off, others have to divide the cell size
+    const int cellSize = m_variant->cellSize;
+    if (strideX < 0 || strideY < 0 ||
+            (strideX > 0 && cellSize % strideX) || (strideY > 0 && cellSize % strideY))
+    {
+        return false;
+    }
+    m_pixelStrideX = strideX == cellSize ? 0 : strideX;
+    m_pixelStrideY = strideY == cellSize ? 0 : strideY;
+    m_engineDirty = true;
+    return true;
+}
+
+void Model::setThreads(int threads)
+{
+    m_threads = qMax(threads, 0);
+}
+
+void Model::setDecoders(int decoders)
+{
+    m_decoders = qMax(decoders, 0);
+}
+
+void Model::setBatchSize(int images)
+{
+    m_batchSize = qMax(images, 1);
 }
 
 void Model::setBootstrap(bool useBootstrap)
@@ -68,6 +390,11 @@ void Model::setBootstrap(bool useBootstrap)
     m_useBootsTrap = useBootstrap;
 }
 
+void Model::setMonitor(ProgressMonitor *monitor)
+{
+    m_monitor = monitor;
+}
+
 void Model::setCV(bool useCV)
 {
     m_useCV = useCV;
@@ -89,6 +416,11 @@ QString Model::getModelFileName()
     return m_modelFileName;
 }
 
+QString Model::getVariant()
+{
+    return m_variant->name;
+}
+
 QString Model::getDirName()
 {
     return m_dirName;
@@ -109,34 +441,74 @@ double Model::getFScore()
     return m_fScore;
 }
 
+QVector<double> Model::getCascadeRejections()
+{
+    // Fraction of scored windows rejected at each cascade stage
+    QVector<double> rejections;
+    for (int i = 0; i < m_stats.cascadeRejected.size(); ++i)
+    {
+        rejections.push_back(m_stats.cascadeWindows
+                             ? double(m_stats.cascadeRejected[i]) / m_stats.cascadeWindows
+                             : 0.0);
+    }
+    return rejections;
+}
+
+double Model::getEarlyTerminationBlocks()
+{
+    // Average fraction of window blocks read before the bound decided
+    if (!m_stats.boundWindows || m_boundScorer.isEmpty())
+        return 0.0;
+    return double(m_stats.boundBlocks) / m_stats.boundWindows / m_boundScorer.blocks();
+}
+
+int Model::getClassifiedImages()
+{
+    return m_classifiedImages;
+}
+
+qint64 Model::getClassifiedWindows()
+{
+    return m_stats.windows;
+}
+
 bool Model::saveModel()
 {
-    // Save model
+    // Save model, there is none before training
+    if (!m_classifier)
+        return false;
     QByteArray ba = m_modelFileName.toLocal8Bit();
     if (save_model(ba.data(), m_classifier))
         return false;
-    else
-        return true;
+    return saveCascadePositives();
 }
 
 bool Model::loadModel()
 {
-    // Load model
+    // The current model stays in place unless the new one is usable
     QByteArray ba = m_modelFileName.toLocal8Bit();
-    if ((m_classifier = load_model(ba.data())) == 0)
+    struct model *classifier = load_model(ba.data());
+    if (!classifier)
         return false;
 
-    // Read number of features from model file
-    QFile file(m_modelFileName);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    // Window geometry follows from the descriptor length
+    const int featuresNumber = get_nr_feature(classifier);
+    const DetectorVariant *variant = DetectorVariants::byFeatures(
+                featuresNumber, m_useLinear ? 1 : 2 * (2 * m_n + 1));
+    if (!variant)
+    {
+        free_and_destroy_model(&classifier);
         return false;
-    QTextStream in(&file);
-    QString str;
-    do
-        in >> str;
-    while (str.compare("nr_feature"));
-    in >> m_featuresNumber;
-    file.close();
+    }
+
+    if (m_classifier)
+        free_and_destroy_model(&m_classifier);
+    m_classifier = classifier;
+    m_featuresNumber = featuresNumber;
+    m_variant = variant;
+    updateWeights();
+    // A model saved without calibration data still loads, canCalibrateCascade() tells
+    loadCascadePositives();
     return true;
 }
 
@@ -198,6 +570,202 @@ void Model::trainModel()
     for (int i = 0; i < m_instancesNumber; i++)
         free(prob.x[i]);
     free(prob.x);
+    updateWeights();
+    updateCascadePositives();
+}
+
+void Model::updateWeights()
+{
+    // Keep a copy of the weights in the precision of the features
+    m_weights.clear();
+    if (m_classifier)
+    {
+        m_weights.resize(m_featuresNumber);
+        qCopy(m_classifier->w, m_classifier->w + m_featuresNumber,
+              m_weights.begin());
+    }
+
+    // Block order of the cascade follows the weights, thresholds are
+    // recalibrated by the next detect()
+    m_cascade.clear();
+    if (m_classifier)
+    {
+        const int blocks = m_variant->winBlocksX * m_variant->winBlocksY;
+        m_cascade.build(m_weights.constData(), m_variant->winBlocksX,
+                        m_variant->winBlocksY, m_featuresNumber / blocks);
+    }
+    m_cascadeDirty = true;
+
+    // Block bounds depend on the weights only, m_bound is checked per window
+    m_boundScorer.clear();
+    m_stats.boundWindows = 0;
+    m_stats.boundBlocks = 0;
+    if (m_classifier)
+    {
+        const int blocks = m_variant->winBlocksX * m_variant->winBlocksY;
+        const int blockCells = m_variant->blockSize * m_variant->blockSize;
+        const int mapLength = m_featuresNumber / (blocks * m_variant->blockFeatures);
+        if (mapLength > 0 && blocks * m_variant->blockFeatures * mapLength == m_featuresNumber)
+        {
+            m_boundScorer.build(m_weights.constData(), m_variant->winBlocksX,
+                                m_variant->winBlocksY, blockCells,
+                                m_variant->bins, mapLength, kernelMapNorm(m_n, m_L));
+        }
+    }
+    m_engineDirty = true;
+}
+
+void Model::updateCascadePositives()
+{
+    // The positives are at hand right after training, loadModel() reads
+    // their stage scores back from the cascade file
+    m_cascadePositives.clear();
+    for (int i = 0; i < m_features.size(); ++i)
+    {
+        if (m_labels[i] != 1)
+            continue;
+        const QVector<double> scores = m_cascade.stageScores(m_features[i]);
+        if (!scores.isEmpty())
+            m_cascadePositives.push_back(scores);
+    }
+    m_cascadeDirty = true;
+}
+
+bool Model::saveCascadePositives()
+{
+    /* "cascade <stages> <positives>", then the stage scores of one
+       positive per line. A model without them leaves no file, so a stale
+       one is not read back with it.
+    */
+    const QString fileName = m_modelFileName + cascadeSuffix;
+    if (m_cascadePositives.isEmpty())
+    {
+        QFile::remove(fileName);
+        return true;
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream out(&file);
+    out << "cascade " << m_cascade.stages() << ' ' << m_cascadePositives.size() << '\n';
+    for (int i = 0; i < m_cascadePositives.size(); ++i)
+    {
+        const QVector<double> &scores = m_cascadePositives[i];
+        for (int s = 0; s < scores.size(); ++s)
+        {
+            out << (s ? " " : "") << QString::number(scores[s], 'g', 17);
+        }
+        out << '\n';
+    }
+    out.flush();
+    file.close();
+    return file.error() == QFile::NoError;
+}
+
+bool Model::loadCascadePositives()
+{
+    m_cascadePositives.clear();
+    m_cascadeDirty = true;
+    QFile file(m_modelFileName + cascadeSuffix);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QTextStream in(&file);
+    QString tag;
+    int stages = 0;
+    int positives = 0;
+    in >> tag >> stages >> positives;
+    if (tag != "cascade" || stages != m_cascade.stages() || positives < 0)
+    {
+        qWarning() << "Cascade file does not match" << m_modelFileName;
+        return false;
+    }
+    for (int i = 0; i < positives; ++i)
+    {
+        QVector<double> scores(stages);
+        for (int s = 0; s < stages; ++s)
+        {
+            in >> scores[s];
+        }
+        if (in.status() != QTextStream::Ok)
+        {
+            qWarning() << "Cascade file of" << m_modelFileName << "is truncated";
+            m_cascadePositives.clear();
+            return false;
+        }
+        m_cascadePositives.push_back(scores);
+    }
+    return true;
+}
+
+void Model::calibrateCascade()
+{
+    // Without positives every threshold stays open and nothing is rejected
+    if (m_cascadePositives.isEmpty())
+    {
+        qWarning() << "No cascade calibration data for" << m_modelFileName <<
+                      "- windows are scored in full";
+    }
+    m_cascade.calibrate(m_cascadePositives, m_bound, m_cascadeTolerance);
+    m_cascadeDirty = false;
+    m_engineDirty = true;
+    m_stats.cascadeWindows = 0;
+    m_stats.cascadeRejected.fill(0, qMax(m_cascade.stages() - 1, 0));
+}
+
+bool Model::canCalibrateCascade() const
+{
+    return !m_cascade.isEmpty() && !m_cascadePositives.isEmpty();
+}
+
+const DetectorEngine &Model::engine()
+{
+    // Thresholds are set once, on the first snapshot that scores with the
+    // cascade
+    if (m_useCascade && m_cascadeDirty && !m_cascade.isEmpty())
+    {
+        calibrateCascade();
+    }
+    updateEngine();
+    return m_engine;
+}
+
+void Model::updateEngine()
+{
+    // Feature extraction during training goes through m_engine as well,
+    // so this never calibrates
+    if (!m_engineDirty)
+        return;
+
+    DetectorEngine::Settings settings;
+    settings.variant = m_variant;
+    settings.useLinear = m_useLinear;
+    settings.n = m_n;
+    settings.L = m_L;
+    settings.bound = m_bound;
+    settings.weights = m_weights;
+    if (!m_useLinear)
+    {
+        updateKernelMap();
+        settings.kernelMap = m_kernelMap;
+    }
+    settings.cascade = m_cascade;
+    settings.useCascade = m_useCascade && !m_cascadeDirty;
+    settings.boundScorer = m_boundScorer;
+    settings.useEarlyTermination = m_useEarlyTermination;
+    settings.octaves = m_octaves;
+    settings.scalesPerOctave = m_scalesPerOctave;
+    settings.useGridScan = m_useGridScan;
+    settings.strideX = m_strideX;
+    settings.strideY = m_strideY;
+    settings.pixelStrideX = m_pixelStrideX;
+    settings.pixelStrideY = m_pixelStrideY;
+    m_engine = DetectorEngine(settings);
+    m_engineDirty = false;
+}
+
+bool Model::isCancelled() const
+{
+    return m_monitor && m_monitor->isCancelled();
 }
 
 void Model::sampleAndTrain()
@@ -205,6 +773,8 @@ void Model::sampleAndTrain()
     m_features.clear();
     m_labels.clear();
     sample();
+    if (isCancelled())
+        return;
     trainModel();
     if (m_useBootsTrap)
     {
@@ -219,23 +789,38 @@ void Model::bootstrapTrain()
     QTime time = QTime::currentTime();
     qsrand((uint)time.msec());
 
+    // A cancelled round is not trained on, the model of the last whole
+    // round stays
+    const int imagesPerRound = BOOTSTRAP_BACK_PER_STEP + pedestrians.size();
+    ProgressTracker progress(m_monitor, "Bootstrapping",
+                             BOOTSTRAP_TIME * imagesPerRound, BOOTSTRAP_TIME);
+    const qint64 windows = m_stats.windows;
     for (int i = 0; i < BOOTSTRAP_TIME; ++i)
     {
         QVector<int> sizes(2, 0);
         for (int j = 0; j < BOOTSTRAP_BACK_PER_STEP; ++j)
         {
+            if (progress.isCancelled())
+                return;
+            progress.update(i * imagesPerRound + j, m_stats.windows - windows, i + 1);
             int rnd = (qrand() + 0.0) / RAND_MAX * backgrounds.size();
             QVector<int> shifts = detect(backgrounds[rnd]);
             sizes[1] += shifts.size();
             for (int k = 0; k < shifts.size(); ++k)
             {
-                QImage badExample(backgrounds[rnd].copy(shifts[k], 0, WIN_WIDTH, WIN_HEIGHT));
+                QImage badExample(backgrounds[rnd].copy(shifts[k], 0,
+                                                        m_variant->winWidth,
+                                                        m_variant->winHeight));
                 m_features.push_back(computeFeatures(computeCells(badExample)));
                 m_labels.push_back(-1);
             }
         }
         for (int j = 0; j < pedestrians.size(); ++j)
         {
+            if (progress.isCancelled())
+                return;
+            progress.update(i * imagesPerRound + BOOTSTRAP_BACK_PER_STEP + j,
+                            m_stats.windows - windows, i + 1);
             QVector<int> shifts = detect(pedestrians[j]);
             if (shifts.size() != 0)
             {
@@ -250,11 +835,11 @@ void Model::bootstrapTrain()
             for (int j = 0; j < size; ++j)
             {
                 int rnd = (qrand() + 0.0) / RAND_MAX * backgrounds.size();
-                int x = (qrand() + 1.0) / RAND_MAX * (backgrounds[rnd].width() - WIN_WIDTH_CELL - 1);
+                int x = (qrand() + 1.0) / RAND_MAX * (backgrounds[rnd].width() - m_variant->winWidthCell - 1);
                 m_features.push_back(computeFeatures(computeCells(backgrounds[rnd].copy(
                                                                       x, 0,
-                                                                      WIN_WIDTH,
-                                                                      WIN_HEIGHT))));
+                                                                      m_variant->winWidth,
+                                                                      m_variant->winHeight))));
                 m_labels.push_back(-1);
             }
         } else {
@@ -267,7 +852,10 @@ void Model::bootstrapTrain()
             }
         }
 
+        if (progress.isCancelled())
+            return;
         trainModel();
+        progress.update((i + 1) * imagesPerRound, m_stats.windows - windows, i + 1);
     }
 }
 
@@ -324,66 +912,24 @@ QVector<int> Model::detect(const QImage &image)
 
        You should return coordinates of all detected objects in QVector<int>.
 
-       Follow instructions in code.
+       The sliding window itself is DetectorEngine::detect().
     */
     QVector<int> areas;
-    QVector<QVector<Cell> > cells = computeCells(image);
-    QVector<double> buff(cells[0].size() - WIN_WIDTH_CELL, 0);
-
-    struct feature_node* x = Malloc(struct feature_node, this->m_featuresNumber + 1);
-    x[m_featuresNumber].index = -1;
-    //        slide with window along image and for each considering
-    //        region do the following
-    for (int i = 0; i < cells[0].size() - WIN_WIDTH_CELL; ++i)
-    {
-        //        compute feature vector of considering region and
-        //        put it in 'descriptor'
-        QVector<double> descriptor = computeFeatures(cells, i);
-
-        for (int j = 0; j < m_featuresNumber; j++)
-        {
-            x[j].index = j+1;
-            x[j].value = descriptor[j];
-        }
-
-        double prob_estimates[1];  // level of confidence
-        predict_values(m_classifier, x, prob_estimates);
-
-        if (prob_estimates[0] > m_bound)
-        {
-            //areas.push_back(i * CELL_SIZE);
-            buff[i] = prob_estimates[0];
-        }
-    }
-    free(x);
-    double max = 0;
-    do
-    {
-        max = 0;
-        int max_i = -2 * WIN_WIDTH_CELL;
-        for (int i = 0; i < buff.size(); ++i)
-        {
-            if (buff[i] > max)
-            {
-                max = buff[i];
-                max_i = i;
-            }
-        }
-        if (max_i > 0)
-        {
-            areas.push_back(max_i * CELL_SIZE);
-        }
-        for (int j = qMax(max_i - WIN_WIDTH_CELL * CROSS_PROC / 100, 0);
-             j < qMin(max_i + 1 + WIN_WIDTH_CELL * CROSS_PROC / 100, buff.size());
-             ++j)
-        {
-            buff[j] = 0;
-        }
-    } while (max > 0);
-
+    if (isCancelled())
+        return areas;
+    engine().detect(image, m_context, areas, &m_stats);
     return areas;
 }
 
+QVector<Detection> Model::detectMultiScale(const QImage &image)
+{
+    QVector<Detection> detections;
+    if (isCancelled())
+        return detections;
+    engine().detectMultiScale(image, m_context, detections, &m_stats);
+    return detections;
+}
+
 void Model::classifyDirectory()
 {
     /* Detect objects on images in directory(m_dirName).
@@ -394,6 +940,8 @@ void Model::classifyDirectory()
        Use Model::detect method to find all objects in image.
     */
 
+    m_classifiedImages = 0;
+    m_stats.windows = 0;
     QFile file(m_userLocationFileName);
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
     {
@@ -408,24 +956,71 @@ void Model::classifyDirectory()
     imgDir.setNameFilters(img_filters);
     QStringList images = imgDir.entryList(QDir::NoFilter, QDir::Name);
 
-    for (int i = 0; i < images.size(); ++i)
+    // Detection buffers and result vectors are reused from image to image
+    const DetectorEngine &detector = engine();
+    QVector<Detection> detections;
+    QVector<int> shifts;
+    const int growths = m_context.growths();
+
+    QTime timer;
+    timer.start();
+    m_classifiedImages = images.size();
+    ProgressTracker progress(m_monitor, "Classifying", images.size());
+    if (m_decoders > 0)
     {
-        qDebug() << "File #" << i;
-        QImage image(m_dirName + images.at(i));
-        QVector<int> shifts = detect(image);
+        // Decoding the next images overlaps detection on the current ones
+        ImagePipeline pipeline(m_decoders, m_threads, m_batchSize);
+        DirectoryDetection detection(detector, m_dirName, images, out,
+                                     pipeline.scorers(), progress);
+        PipelineJob job(detection);
+        pipeline.run(job, images.size());
+        detection.addStats(m_stats);
+        logPipeline(pipeline);
+    } else if (m_threads != 1) {
+        // Images are independent, only the output order is shared
+        WorkStealingPool pool(m_threads);
+        DirectoryDetection detection(detector, m_dirName, images, out,
+                                     pool.workers(), progress);
+        DirectoryJob job(detection, images.size());
+        pool.run(job, images.size(), m_batchSize);
+        detection.addStats(m_stats);
+        qDebug() << "Workers:" << pool.workers() << "steals:" << pool.steals();
+    } else {
+        for (int i = 0; i < images.size() && !progress.isCancelled(); ++i)
+        {
+            qDebug() << "File #" << i;
+            QImage image(m_dirName + images.at(i));
 
-        QString fileName = images.at(i);
-        fileName = fileName.left(fileName.lastIndexOf('.'));
+            QString fileName = images.at(i);
+            fileName = fileName.left(fileName.lastIndexOf('.'));
 
-        for (int j = 0; j < shifts.size(); ++j)
-        {
-            out << fileName << ' ' <<
-                   shifts[j] << ' ' <<
-                   0 << ' ' << WIN_WIDTH << ' ' <<
-                   WIN_HEIGHT << '\n';
-            qDebug() << fileName << shifts[j] << 0 << WIN_WIDTH << WIN_HEIGHT;
+            if (detector.detectsBoxes())
+            {
+                detector.detectMultiScale(image, m_context, detections, &m_stats);
+                writeBoxes(out, fileName, detections);
+            } else {
+                detector.detect(image, m_context, shifts, &m_stats);
+                writeShifts(out, fileName, shifts, m_variant);
+                for (int j = 0; j < shifts.size(); ++j)
+                {
+                    qDebug() << fileName << shifts[j] << 0 << m_variant->winWidth << m_variant->winHeight;
+                }
+            }
+            progress.update(i + 1, m_stats.windows);
         }
     }
+    if (progress.isCancelled())
+    {
+        qDebug() << "Classification cancelled";
+    }
+    qDebug() << "Windows per second:" << m_stats.windows * 1000.0 / qMax(timer.elapsed(), 1);
+    qDebug() << "Detection buffer growths:" << m_context.growths() - growths;
+    if (m_useCascade)
+    {
+        qDebug() << "Cascade rejections per stage:" << getCascadeRejections();
+    } else if (m_useEarlyTermination) {
+        qDebug() << "Blocks read per window:" << getEarlyTerminationBlocks();
+    }
 
     file.close();
 }
@@ -490,7 +1085,7 @@ bool Model::estimateQuality()
     rlIter = real.begin();
 
     int tp = 0, tp1 = 0;
-    int prevShift = -2 * WIN_WIDTH;
+    int prevShift = -2 * m_variant->winWidth;
     QString prevName = "";
 
     qDebug() << "Estimating...";
@@ -521,7 +1116,7 @@ bool Model::estimateQuality()
         QVector<int> rlShifts = rlIter->second;
         while (i < trShifts.size() && j < rlShifts.size())
         {
-            while (trShifts[i] < rlShifts[j] - WIN_WIDTH * CROSS_PROC / 100 &&
+            while (trShifts[i] < rlShifts[j] - m_variant->winWidth * CROSS_PROC / 100 &&
                    i < trShifts.size())
             {
                 ++i;
@@ -530,11 +1125,11 @@ bool Model::estimateQuality()
             {
                 break;
             }
-            while (qAbs(trShifts[i] - rlShifts[j]) <= WIN_WIDTH * CROSS_PROC / 100 &&
+            while (qAbs(trShifts[i] - rlShifts[j]) <= m_variant->winWidth * CROSS_PROC / 100 &&
                    i < trShifts.size() && j < rlShifts.size())
             {
                 if (QString::compare(prevName, trIter->first) ||
-                        qAbs(trShifts[i] - prevShift) > WIN_WIDTH * CROSS_PROC / 100)
+                        qAbs(trShifts[i] - prevShift) > m_variant->winWidth * CROSS_PROC / 100)
                 {
                     ++tp1;
                     prevShift = trShifts[i];
@@ -548,7 +1143,7 @@ bool Model::estimateQuality()
             {
                 break;
             }
-            while (trShifts[i] > rlShifts[j] + WIN_WIDTH * CROSS_PROC / 100 &&
+            while (trShifts[i] > rlShifts[j] + m_variant->winWidth * CROSS_PROC / 100 &&
                    j < rlShifts.size())
             {
                 ++j;
@@ -583,142 +1178,53 @@ QImage Model::scanImage(const QString &imageName)
     paint.setPen(QColor(0, 255, 0));
     paint.setBrush(Qt::NoBrush);
 
+    if (engine().detectsBoxes())
+    {
+        QVector<Detection> detections = detectMultiScale(image);
+        for (int i = 0; i < detections.size(); ++i)
+        {
+            paint.drawRect(detections[i].box);
+        }
+        return image;
+    }
+
     QVector<int> shifts = detect(image);
 
     for (int i = 0; i < shifts.size(); ++i)
     {
-        paint.drawRect(shifts[i], 0, WIN_WIDTH, WIN_HEIGHT);
+        paint.drawRect(shifts[i], 0, m_variant->winWidth, m_variant->winHeight);
     }
 
     return image;
 }
 
-int Model::defCell(qreal dx, qreal dy)
+QVector<QVector<Model::Cell> > Model::computeCells(const QImage &image,
+                                                   int maxRows)
 {
-    qreal direction = qAtan2(dx, dy);
-    if (dx < 0)
-    {
-        direction += 2 * M_PI;
-    }
-    return floor(direction * 4 / M_PI);
+    updateEngine();
+    return m_engine.computeCells(image, maxRows);
 }
 
-QVector<QVector<Model::Cell> > Model::computeCells(const QImage &image)
+QVector<Model::Feature> Model::computeFeatures(const QVector<QVector<Cell> > &cells,
+                                               int shift)
 {
-    QVector<QVector<int> > grads(image.width(), QVector<int>(image.height(), 0));
-    QVector<QVector<qreal> > filter = generateFilter();
-    QVector<QVector<int> > buffer(image.width(), QVector<int>(image.height(), 0));
-
-    for (int y = 0; y < image.height(); ++y)
-    {
-        QRgb *row = (QRgb *)image.scanLine(y);
-        for (int x = 0; x < image.width(); ++x)
-        {
-            QRgb rgb = row[x];
-            int grayLvl = 0.2125 * qRed(rgb) + 0.7154 * qGreen(rgb) +
-                    0.0721 * qBlue(rgb);
-            buffer[x][y] = grayLvl;
-        }
-    }
-
-    for (int y = 1; y < image.height() - 1; ++y)
-    {
-        for (int x = 1; x < image.width() - 1; ++x)
-        {
-            double dx = 0, dy = 0;
-            for (int i = 0; i < filter.size(); ++i)
-            {
-                for (int j = 0; j < filter[0].size(); ++j)
-                {
-                    int grayLvl = buffer[x - 1 + i][y - 1 + j];
-                    dx += filter[i][j] * grayLvl;
-                    dy += filter[j][i] * grayLvl;
-                }
-            }
-            grads[x][y] = defCell(dx, dy);
-        }
-    }
-    grads[0][0] = 0;
-    grads[0][image.height() - 1] = 0;
-    grads[image.width() - 1][0] = 0;
-    grads[image.width() - 1][image.height() - 1] = 0;
-
-    QVector<QVector<Cell> > cells(image.height() / CELL_SIZE,
-                                  QVector<Cell>(image.width() / CELL_SIZE,
-                                                Cell(CELL_SIZE, 0)));
-    for (int i = 0; i < cells.size(); ++i)
-    {
-        for (int j = 0; j < cells[0].size(); ++j)
-        {
-            for (int dy = 0; dy < CELL_SIZE; ++dy)
-            {
-                int y = i * CELL_SIZE + dy;
-                for (int dx = 0; dx < CELL_SIZE; ++dx)
-                {
-                    int x = j * CELL_SIZE + dx;
-                    ++cells[i][j][grads[x][y]];
-                }
-            }
-        }
-    }
-
-    return cells;
+    updateEngine();
+    return m_engine.computeFeatures(cells, shift);
 }
 
-QVector<double> Model::computeFeatures(const QVector<QVector<Cell> > &cells,
-                                       int shift)
+void Model::updateKernelMap()
 {
-    QVector<double> descriptor;
-    for (int y = 0; y < WIN_HEIGHT_CELL - BLOCK_SIZE + 1; ++ y)
+    const int blockPixels = m_variant->blockPixels;
+    if (m_kernelMapN == m_n && m_kernelMapL == m_L &&
+            m_kernelMapPixels == blockPixels)
     {
-        for (int x = 0; x < WIN_WIDTH_CELL - BLOCK_SIZE + 1; ++x)
-        {
-            Cell localCell(CELL_SIZE, 0);
-            for (int i = 0; i < BLOCK_SIZE; ++i)
-            {
-                for (int j = 0; j < BLOCK_SIZE; ++j)
-                {
-                    for (int k = 0; k < CELL_SIZE; ++k)
-                    {
-                        localCell[k] += cells[y + i][x + shift +j][k];
-                    }
-                }
-            }
-            for (int i = 0; i < BLOCK_SIZE; ++i)
-            {
-                for (int j = 0; j < BLOCK_SIZE; ++j)
-                {
-                    for (int k = 0; k < CELL_SIZE; ++k)
-                    {
-                        if (localCell[k] == 0)
-                        {
-                            descriptor.push_back(0);
-                            continue;
-                        }
-                        descriptor.push_back(cells[y + i][x + shift + j][k] / localCell[k]);
-                    }
-                }
-            }
-        }
-    }
-
-    if (!m_useLinear)
-    {
-        descriptor = convertFeatures(descriptor);
+        return;
     }
 
-    return descriptor;
-}
-
-QVector<QVector<qreal> > Model::generateFilter()
-{
-    QVector<QVector<qreal> > filter(3, QVector<qreal>(3, 0));
-    filter[0] = QVector<qreal>(3, -1);
-    filter[2] = QVector<qreal>(3, 1);
-    filter[0][1] = -2;
-    filter[2][1] = 2;
-
-    return filter;
+    m_kernelMap = DetectorEngine::buildKernelMap(blockPixels, m_n, m_L);
+    m_kernelMapN = m_n;
+    m_kernelMapL = m_L;
+    m_kernelMapPixels = blockPixels;
 }
 
 void Model::sampleNegative()
@@ -733,33 +1239,35 @@ void Model::sampleNegative()
     qsrand((uint)time.msec());
 
     qDebug() << "Negative";
-    for (int i = 0; i < negative.size(); ++i)
+    ProgressTracker progress(m_monitor, "Sampling negatives", negative.size());
+    for (int i = 0; i < negative.size() && !progress.isCancelled(); ++i)
     {
         qDebug() << i << " / " << negative.size();
         QImage image(m_dirName + "negative/" + negative.at(i));
 
-        if (WIN_WIDTH * BACKGROUND_PER_IMG >= image.width())
+        if (m_variant->winWidth * BACKGROUND_PER_IMG >= image.width())
         {
             QVector<QVector<Cell> > cells = computeCells(image);
             for (int j = 0; j < BACKGROUND_PER_IMG; ++j)
             {
-                int x = (qrand() + 1.0) / RAND_MAX * (image.width() / CELL_SIZE
-                                                      - WIN_WIDTH_CELL - 1);
+                int x = (qrand() + 1.0) / RAND_MAX * (image.width() / m_variant->cellSize
+                                                      - m_variant->winWidthCell - 1);
                 m_features.push_back(computeFeatures(cells, x));
                 m_labels.push_back(-1);
             }
         } else {
             for (int j = 0; j < BACKGROUND_PER_IMG; ++j)
             {
-                int x = (qrand() + 1.0) / RAND_MAX * (image.width() - WIN_WIDTH_CELL);
-                int y = (qrand() + 1.0) / RAND_MAX * (image.height() - WIN_HEIGHT_CELL);
+                int x = (qrand() + 1.0) / RAND_MAX * (image.width() - m_variant->winWidthCell);
+                int y = (qrand() + 1.0) / RAND_MAX * (image.height() - m_variant->winHeightCell);
                 m_features.push_back(computeFeatures(computeCells(image.copy(
                                                                       x, y,
-                                                                      WIN_WIDTH,
-                                                                      WIN_HEIGHT))));
+                                                                      m_variant->winWidth,
+                                                                      m_variant->winHeight))));
                 m_labels.push_back(-1);
             }
         }
+        progress.update(i + 1, 0);
     }
 }
 
@@ -778,9 +1286,9 @@ QVector<QImage> Model::getBackgrounds()
     {
         qDebug() << i << " / " << negative.size();
         QImage image(m_dirName + "negative/" + negative.at(i));
-        for (int y = 0; y < image.height() - WIN_HEIGHT; y += BACK_STEP)
+        for (int y = 0; y < image.height() - m_variant->winHeight; y += BACK_STEP)
         {
-            badExamples.push_back(image.copy(0, y, image.width(), WIN_HEIGHT));
+            badExamples.push_back(image.copy(0, y, image.width(), m_variant->winHeight));
         }
         //badExamples.push_back(image);
     }
@@ -818,39 +1326,16 @@ void Model::samplePositive()
     QStringList positive = posDir.entryList(QDir::NoFilter, QDir::Name);
 
     qDebug() << "Positive";
-    for (int i = 0; i < positive.size(); ++i)
+    ProgressTracker progress(m_monitor, "Sampling positives", positive.size());
+    for (int i = 0; i < positive.size() && !progress.isCancelled(); ++i)
     {
         qDebug() << i << " / " << positive.size();
         QImage image(m_dirName + "positive/" + positive.at(i));
         QVector<QVector<Cell> > cells = computeCells(image);
-        QVector<double> descriptor = computeFeatures(cells);
+        QVector<Feature> descriptor = computeFeatures(cells);
         m_features.push_back(descriptor);
         m_labels.push_back(1);
+        progress.update(i + 1, 0);
     }
 
 }
-
-QVector<double> Model::convertFeatures(const QVector<double> &features)
-{
-        QVector<double> new_vector;
-        for (int j = 0; j < features.size(); ++j)
-        {
-            for (int k = -m_n; k <= m_n; ++k)
-            {
-                if (features[j] == 0)
-                {
-                    new_vector.push_back(0);
-                    new_vector.push_back(0);
-                    continue;
-                }
-                double lambda = k * m_L;
-                double re = qCos(lambda * qLn(features[j]));
-                double im = -qSin(lambda * qLn(features[j]));
-                double add = qSqrt(features[j] * sech(M_PI * lambda));
-                new_vector.push_back(re * add);
-                new_vector.push_back(im * add);
-            }
-        }
-
-    return new_vector;
-}
@@ -10,7 +10,11 @@
 #include <QTime>
 #include <QPainter>
 #include <QDebug>
+#include <QVarLengthArray>
 #include <map>
+#include "detectorengine.h"
+#include "detectioncontext.h"
+#include "progress.h"
 
 class Model
 {
@@ -26,38 +30,68 @@ public:
     void classifyDirectory();
     bool estimateQuality();
     QImage scanImage(const QString &imageName);
+    QVector<Detection> detectMultiScale(const QImage &image);
+    // Snapshot of the trained detector and its settings, see DetectorEngine.
+    // Calibrates the cascade first if it is on. Copies stay valid and
+    // unchanged whatever is done to the model afterwards.
+    const DetectorEngine &engine();
+    // Whether the cascade has positives to be calibrated on: after training,
+    // or after loading a model saved with its cascade file. Without them the
+    // cascade rejects nothing.
+    bool canCalibrateCascade() const;
 
     void setTrueLocationFileName(const QString &fileName);
     void setUserLocationFileName(const QString &fileName);
     void setModelFileName(const QString &fileName);
     void setDirName(const QString &dirName);
     void setKernel(bool useLinear);
+    // False for an unknown name or one the current weights do not fit
+    bool setVariant(const QString &name);
     void setBound(double bound);
+    void setCascade(bool useCascade);
+    void setCascadeTolerance(double tolerance);
+    void setEarlyTermination(bool useEarlyTermination);
+    void setPyramid(int octaves, int scalesPerOctave);
+    void setGridScan(bool useGridScan);
+    void setStrides(int strideX, int strideY);
+    bool setPixelStrides(int strideX, int strideY);
+    // Workers of classifyDirectory(), 1 for the serial loop and 0 for one
+    // per core
+    void setThreads(int threads);
+    // Threads decoding images for classifyDirectory() ahead of the
+    // workers, 0 for decoding in the workers; the workers are then scoring
+    // threads, 0 of them for one per core
+    void setDecoders(int decoders);
+    // Images a worker of classifyDirectory() takes at once, or each queue
+    // between pipeline stages holds
+    void setBatchSize(int images);
     void setBootstrap(bool useBootstrap);
+    // Gets the progress of sampling, bootstrapping and classifyDirectory()
+    // and can cancel them between images; NULL for none
+    void setMonitor(ProgressMonitor *monitor);
     void setCV(bool useCV);
 
     QString getTrueLocationFileName();
     QString getUserLocationFileName();
     QString getModelFileName();    
     QString getDirName();
+    QString getVariant();
     double getPrecision();
     double getRecall();
     double getFScore();
+    QVector<double> getCascadeRejections();
+    double getEarlyTerminationBlocks();
+    // Images read and windows scored by the last classifyDirectory()
+    int getClassifiedImages();
+    qint64 getClassifiedWindows();
 
-    typedef QVector<double> Cell;
+    typedef HogFeature Feature;
+    typedef HogCell Cell;
 
 private:
     enum
     {
         CELL_NUM = 8,
-        CELL_SIZE = 8,
-
-        BLOCK_SIZE = 2,
-
-        WIN_WIDTH = 80,
-        WIN_HEIGHT = 200,
-        WIN_WIDTH_CELL = 10,
-        WIN_HEIGHT_CELL = 25,
 
         BACKGROUND_PER_IMG = 1,
         CROSS_PROC = 50,
@@ -66,23 +100,31 @@ private:
         BOOTSTRAP_BACK_PER_STEP = 100,
         BACK_STEP = 60,
 
-        CV_TIME = 5
+        CV_TIME = 5,
+
+        // Default of setBatchSize()
+        IMAGES_PER_BATCH = 4
     };
     void sample();
     void trainModel();
     QVector<int> detect(const QImage &image);
-    int defCell(qreal dx, qreal dy);
-    QVector<QVector<Cell> > computeCells(const QImage &image);
-    QVector<double> computeFeatures(const QVector<QVector<Cell> > &cells,
-                                    int shift = 0);
-    QVector<QVector<double> > generateFilter();
+    QVector<QVector<Cell> > computeCells(const QImage &image, int maxRows = -1);
+    QVector<Feature> computeFeatures(const QVector<QVector<Cell> > &cells,
+                                     int shift = 0);
+    void updateWeights();
+    void updateCascadePositives();
+    bool saveCascadePositives();
+    bool loadCascadePositives();
+    void calibrateCascade();
     void samplePositive();
     void sampleNegative();
     QVector<QImage> getBackgrounds();
     QVector<QImage> getPedestrians();
-    QVector<double> convertFeatures(const QVector<double> &features);
+    void updateKernelMap();
+    void updateEngine();
+    bool isCancelled() const;
 
-    QVector< QVector<double> > m_features;
+    QVector< QVector<Feature> > m_features;
     QVector<int> m_labels;
     int m_featuresNumber;
     int m_instancesNumber;
@@ -99,7 +141,46 @@ private:
     bool m_useCV;
     int m_n;
     double m_L;
+    QVector<Feature> m_kernelMap;
+    int m_kernelMapN;
+    double m_kernelMapL;
+    QVector<Feature> m_weights;
+    SoftCascade m_cascade;
+    // Stage scores of the training positives, see SoftCascade::calibrate()
+    QVector<QVector<double> > m_cascadePositives;
+    bool m_useCascade;
+    double m_cascadeTolerance;
+    bool m_cascadeDirty;
+    BoundScorer m_boundScorer;
+    bool m_useEarlyTermination;
+    // Octaves below the image scale scanned by detectMultiScale(), 0 for
+    // single scale detection
+    int m_octaves;
+    int m_scalesPerOctave;
+    // Scan every window row of a level, strides in cells
+    bool m_useGridScan;
+    int m_strideX;
+    int m_strideY;
+    // Sub-cell strides in pixels for octave levels, 0 for none
+    int m_pixelStrideX;
+    int m_pixelStrideY;
+    int m_threads;
+    int m_decoders;
+    int m_batchSize;
+    int m_classifiedImages;
     double m_bound;
+    int m_kernelMapPixels;
+    const DetectorVariant *m_variant;
+    // Built from the members above by updateEngine() whenever one of them
+    // changed
+    DetectorEngine m_engine;
+    bool m_engineDirty;
+    // Work of the detections through m_engine; cascade counters since the
+    // last calibration, bound counters since the last updateWeights()
+    DetectionStats m_stats;
+    // Scratch memory of every detection made by the model
+    DetectionContext m_context;
+    ProgressMonitor *m_monitor;
 };
 
 #endif // MODEL_H
@@ -0,0 +1,129 @@
+#include "modelworker.h"
+
+ModelWorker::ModelWorker()
+    : m_model(new Model()),
+      m_cancelled(0)
+{
+    m_model->setMonitor(this);
+}
+
+ModelWorker::~ModelWorker()
+{
+    delete m_model;
+}
+
+void ModelWorker::cancel()
+{
+    m_cancelled.fetchAndStoreRelease(1);
+}
+
+void ModelWorker::reportProgress(const Progress &progress)
+{
+    emit progressed(progress);
+}
+
+bool ModelWorker::isCancelled() const
+{
+    return m_cancelled.fetchAndAddAcquire(0) != 0;
+}
+
+void ModelWorker::setTrueLocationFileName(const QString &fileName)
+{
+    m_model->setTrueLocationFileName(fileName);
+}
+
+void ModelWorker::setUserLocationFileName(const QString &fileName)
+{
+    m_model->setUserLocationFileName(fileName);
+}
+
+void ModelWorker::setModelFileName(const QString &fileName)
+{
+    m_model->setModelFileName(fileName);
+}
+
+void ModelWorker::setDirName(const QString &dirName)
+{
+    m_model->setDirName(dirName);
+}
+
+void ModelWorker::setKernel(bool useLinear)
+{
+    m_model->setKernel(useLinear);
+}
+
+void ModelWorker::setBound(double bound)
+{
+    m_model->setBound(bound);
+}
+
+void ModelWorker::setBootstrap(bool useBootstrap)
+{
+    m_model->setBootstrap(useBootstrap);
+}
+
+void ModelWorker::resume()
+{
+    m_cancelled.fetchAndStoreRelease(0);
+}
+
+void ModelWorker::saveModel()
+{
+    if (!isCancelled() && !m_model->saveModel())
+        emit warning("Can not save model file!");
+    emit finished();
+}
+
+void ModelWorker::loadModel()
+{
+    if (!isCancelled() && !m_model->loadModel())
+        emit warning("Can not load model file!");
+    emit finished();
+}
+
+void ModelWorker::train()
+{
+    if (!isCancelled())
+        m_model->sampleAndTrain();
+    emit finished();
+}
+
+void ModelWorker::crossValidation()
+{
+    if (!isCancelled())
+        m_model->crossValidation();
+    emit finished();
+}
+
+void ModelWorker::classifyDirectory()
+{
+    if (!isCancelled())
+        m_model->classifyDirectory();
+    emit finished();
+}
+
+void ModelWorker::estimateQuality()
+{
+    if (!isCancelled())
+    {
+        if (m_model->estimateQuality())
+        {
+            emit qualityEstimated(m_model->getPrecision(), m_model->getRecall(),
+                                  m_model->getFScore());
+        } else {
+            emit warning("Can not open annotation file!");
+        }
+    }
+    emit finished();
+}
+
+void ModelWorker::scanImage(const QString &imageName)
+{
+    if (!isCancelled())
+    {
+        const QImage image = m_model->scanImage(imageName);
+        if (!isCancelled())
+            emit imageScanned(image);
+    }
+    emit finished();
+}
@@ -0,0 +1,63 @@
+#ifndef MODELWORKER_H
+#define MODELWORKER_H
+
+#include <QObject>
+#include <QImage>
+#include <QAtomicInt>
+#include "model.h"
+
+/* Owns the Model and makes every call on it from the thread it lives in.
+   Controller moves it to a thread of its own and calls its slots through
+   queued connections, so operations run one at a time in the order they
+   were asked for while the GUI stays responsive. Results come back as
+   signals.
+
+   cancel() may be called from any thread. The running operation returns
+   at its next image and the operations queued after it are skipped, until
+   resume() is reached in the queue.
+*/
+class ModelWorker : public QObject, public ProgressMonitor
+{
+    Q_OBJECT
+
+public:
+    ModelWorker();
+    ~ModelWorker();
+
+    void cancel();
+    void reportProgress(const Progress &progress);
+    bool isCancelled() const;
+
+public slots:
+    void setTrueLocationFileName(const QString &fileName);
+    void setUserLocationFileName(const QString &fileName);
+    void setModelFileName(const QString &fileName);
+    void setDirName(const QString &dirName);
+    void setKernel(bool useLinear);
+    void setBound(double bound);
+    void setBootstrap(bool useBootstrap);
+    void resume();
+
+    // Operations, each ends with finished()
+    void saveModel();
+    void loadModel();
+    void train();
+    void crossValidation();
+    void classifyDirectory();
+    void estimateQuality();
+    void scanImage(const QString &imageName);
+
+signals:
+    void progressed(const Progress &progress);
+    void warning(const QString &message);
+    void qualityEstimated(double precision, double recall, double fScore);
+    void imageScanned(const QImage &image);
+    // Also sent when the operation was skipped or cancelled
+    void finished();
+
+private:
+    Model *m_model;
+    mutable QAtomicInt m_cancelled;
+};
+
+#endif // MODELWORKER_H
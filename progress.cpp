@@ -0,0 +1,41 @@
+#include "progress.h"
+
+ProgressTracker::ProgressTracker(ProgressMonitor *monitor,
+                                 const QString &operation, int total,
+                                 int rounds)
+    : m_monitor(monitor),
+      m_lastReport(-REPORT_MSECS)
+{
+    m_progress.operation = operation;
+    m_progress.total = total;
+    m_progress.rounds = rounds;
+    m_timer.start();
+    update(0, 0, rounds > 0 ? 1 : 0);
+}
+
+void ProgressTracker::update(int done, qint64 windows, int round)
+{
+    if (!m_monitor)
+        return;
+
+    // The last image is always reported, the others only now and then
+    const qint64 elapsed = m_timer.elapsed();
+    if (done < m_progress.total && elapsed - m_lastReport < REPORT_MSECS)
+        return;
+    m_lastReport = elapsed;
+
+    m_progress.done = done;
+    m_progress.round = round;
+    const double seconds = qMax(elapsed, qint64(1)) / 1000.0;
+    m_progress.imagesPerSecond = done / seconds;
+    m_progress.windowsPerSecond = windows / seconds;
+    m_progress.etaMsecs = done > 0
+            ? qint64(double(elapsed) * (m_progress.total - done) / done)
+            : -1;
+    m_monitor->reportProgress(m_progress);
+}
+
+bool ProgressTracker::isCancelled() const
+{
+    return m_monitor && m_monitor->isCancelled();
+}
@@ -0,0 +1,68 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <QString>
+#include <QMetaType>
+#include <QElapsedTimer>
+
+// Where a long Model operation stands, see ProgressMonitor
+struct Progress
+{
+    Progress()
+        : done(0), total(0), round(0), rounds(0), imagesPerSecond(0.0),
+          windowsPerSecond(0.0), etaMsecs(-1)
+    {
+    }
+
+    QString operation;
+    // Images handled so far and in all
+    int done;
+    int total;
+    // Bootstrap round counted from 1 and rounds in all, 0 otherwise
+    int round;
+    int rounds;
+    double imagesPerSecond;
+    double windowsPerSecond;
+    // Time left at the rate so far, -1 until anything is done
+    qint64 etaMsecs;
+};
+
+Q_DECLARE_METATYPE(Progress)
+
+// Receives the progress of Model operations and may cancel them, see
+// Model::setMonitor(). Both are called from the thread running the
+// operation, or any worker thread of it.
+class ProgressMonitor
+{
+public:
+    virtual ~ProgressMonitor() {}
+    virtual void reportProgress(const Progress &progress) = 0;
+    // Polled between images; once true the operation returns early
+    virtual bool isCancelled() const = 0;
+};
+
+/* Progress of one operation: turns counts of images and windows into
+   rates and an estimate of the time left, and hands them to a monitor at
+   most every REPORT_MSECS. Without a monitor it does nothing. Calls must
+   not overlap.
+*/
+class ProgressTracker
+{
+public:
+    ProgressTracker(ProgressMonitor *monitor, const QString &operation,
+                    int total, int rounds = 0);
+
+    // 'windows' is the count scored since the operation started
+    void update(int done, qint64 windows, int round = 0);
+    bool isCancelled() const;
+
+private:
+    enum { REPORT_MSECS = 100 };
+
+    ProgressMonitor *m_monitor;
+    Progress m_progress;
+    QElapsedTimer m_timer;
+    qint64 m_lastReport;
+};
+
+#endif // PROGRESS_H
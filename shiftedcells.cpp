@@ -0,0 +1,95 @@
+#include "shiftedcells.h"
+#include "cellstream.h"
+#include <QVarLengthArray>
+
+ShiftedCells::ShiftedCells(const QImage &image, int cellSize, int bins,
+                           int strideX, int strideY)
+    : m_cellSize(cellSize),
+      m_bins(bins),
+      m_strideX(strideX),
+      m_strideY(strideY),
+      m_width(image.width()),
+      m_height(image.height()),
+      m_sumRows(0),
+      m_sumCols(0)
+{
+    const int tilesX = cellSize / strideX;
+    const int tilesY = cellSize / strideY;
+    CellStream stream(image, strideX, strideY, bins);
+    m_sumRows = stream.rows() - tilesY + 1;
+    m_sumCols = stream.cols() - tilesX + 1;
+    if (m_sumRows <= 0 || m_sumCols <= 0)
+    {
+        m_sumRows = m_sumCols = 0;
+        return;
+    }
+    m_sums.fill(0, m_sumRows * m_sumCols * bins);
+
+    // Tile row r is added to the cells of sum rows [r - tilesY + 1, r]
+    QVector<HogFeature> tiles(stream.cols() * bins);
+    QVector<HogFeature> rowSums(m_sumCols * bins);
+    for (int r = 0; stream.readRow(tiles.data()); ++r)
+    {
+        // Running sum over tilesX tiles along the row
+        QVarLengthArray<HogFeature, 16> window(bins);
+        qFill(window.data(), window.data() + bins, HogFeature(0));
+        for (int c = 0; c < stream.cols(); ++c)
+        {
+            const HogFeature *entering = tiles.constData() + c * bins;
+            for (int k = 0; k < bins; ++k)
+            {
+                window[k] += entering[k];
+            }
+            if (c >= tilesX)
+            {
+                const HogFeature *leaving = entering - tilesX * bins;
+                for (int k = 0; k < bins; ++k)
+                {
+                    window[k] -= leaving[k];
+                }
+            }
+            if (c >= tilesX - 1)
+            {
+                qCopy(window.constData(), window.constData() + bins,
+                      rowSums.data() + (c - tilesX + 1) * bins);
+            }
+        }
+        for (int row = qMax(r - tilesY + 1, 0); row <= qMin(r, m_sumRows - 1); ++row)
+        {
+            HogFeature *out = m_sums.data() + row * m_sumCols * bins;
+            for (int i = 0; i < rowSums.size(); ++i)
+            {
+                out[i] += rowSums[i];
+            }
+        }
+    }
+}
+
+int ShiftedCells::offsetsX() const
+{
+    return m_cellSize / m_strideX;
+}
+
+int ShiftedCells::offsetsY() const
+{
+    return m_cellSize / m_strideY;
+}
+
+HogCells ShiftedCells::cells(int x, int y) const
+{
+    const int tilesX = m_cellSize / m_strideX;
+    const int tilesY = m_cellSize / m_strideY;
+    const int rows = m_sumRows ? (m_height - y * m_strideY) / m_cellSize : 0;
+    const int cols = m_sumCols ? (m_width - x * m_strideX) / m_cellSize : 0;
+    HogCells cells(qMax(rows, 0), QVector<HogCell>(qMax(cols, 0), HogCell(m_bins)));
+    for (int i = 0; i < cells.size(); ++i)
+    {
+        for (int j = 0; j < cols; ++j)
+        {
+            const HogFeature *sum = m_sums.constData() +
+                    ((y + i * tilesY) * m_sumCols + x + j * tilesX) * m_bins;
+            qCopy(sum, sum + m_bins, cells[i][j].begin());
+        }
+    }
+    return cells;
+}
@@ -0,0 +1,43 @@
+#ifndef SHIFTEDCELLS_H
+#define SHIFTEDCELLS_H
+
+#include <QImage>
+#include <QVector>
+#include "hogcore.h"
+
+/* Cell grids of an image for cell origins off the cell lattice.
+
+   Orientation bins are counted once, into strideX x strideY pixel tiles
+   (a CellStream with rectangular cells). Sliding sums of cellSize /
+   strideX tiles along rows and cellSize / strideY tile rows then give the
+   histogram of a cellSize square at every tile position, so the grid of
+   any offset (x * strideX, y * strideY) is a strided view of those sums.
+   Both strides must divide cellSize; the grid at offset (0, 0) is the
+   one CellStream computes.
+*/
+class ShiftedCells
+{
+public:
+    ShiftedCells(const QImage &image, int cellSize, int bins, int strideX,
+                 int strideY);
+
+    int offsetsX() const;
+    int offsetsY() const;
+    // Cells starting at pixel (x * strideX, y * strideY), x < offsetsX(),
+    // y < offsetsY()
+    HogCells cells(int x, int y) const;
+
+private:
+    int m_cellSize;
+    int m_bins;
+    int m_strideX;
+    int m_strideY;
+    int m_width;
+    int m_height;
+    // Histogram of the cell at tile (row, col), row-major, m_sumCols per row
+    int m_sumRows;
+    int m_sumCols;
+    QVector<HogFeature> m_sums;
+};
+
+#endif // SHIFTEDCELLS_H
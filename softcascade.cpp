@@ -0,0 +1,201 @@
+#include "softcascade.h"
+#include <QtAlgorithms>
+#include <QtCore/qmath.h>
+#include <limits>
+
+namespace
+{
+
+struct BlockImportance
+{
+    double norm;
+    int index;
+
+    bool operator<(const BlockImportance &other) const
+    {
+        return norm > other.norm || (norm == other.norm && index < other.index);
+    }
+};
+
+} // namespace
+
+SoftCascade::SoftCascade()
+{
+    m_blockLength = 0;
+    m_winBlocksX = 0;
+}
+
+void SoftCascade::build(const HogFeature *w, int winBlocksX, int winBlocksY,
+                        int blockLength)
+{
+    clear();
+    const int blocks = winBlocksX * winBlocksY;
+    if (blocks <= 0 || blockLength <= 0)
+        return;
+    m_blockLength = blockLength;
+    m_winBlocksX = winBlocksX;
+
+    QVector<BlockImportance> order(blocks);
+    for (int i = 0; i < blocks; ++i)
+    {
+        double norm = 0;
+        for (int k = 0; k < blockLength; ++k)
+        {
+            norm += double(w[i * blockLength + k]) * w[i * blockLength + k];
+        }
+        order[i].norm = norm;
+        order[i].index = i;
+    }
+    qSort(order);
+
+    m_weights.resize(blocks * blockLength);
+    HogFeature *ordered = m_weights.data();
+    for (int i = 0; i < blocks; ++i)
+    {
+        m_blockX.push_back(order[i].index % winBlocksX);
+        m_blockY.push_back(order[i].index / winBlocksX);
+        qCopy(w + order[i].index * blockLength,
+              w + (order[i].index + 1) * blockLength, ordered);
+        ordered += blockLength;
+    }
+
+    for (int end = 1; end < blocks; end *= 2)
+    {
+        m_stageEnds.push_back(end);
+    }
+    m_stageEnds.push_back(blocks);
+    // Nothing is rejected until calibrate()
+    m_thresholds.fill(-std::numeric_limits<double>::max(), m_stageEnds.size() - 1);
+}
+
+QVector<double> SoftCascade::stageScores(const QVector<HogFeature> &descriptor) const
+{
+    QVector<double> scores;
+    if (isEmpty() || descriptor.size() != m_weights.size())
+        return scores;
+    double partial = 0;
+    int first = 0;
+    for (int s = 0; s < m_stageEnds.size(); ++s)
+    {
+        partial += partialScore(descriptor.constData(), m_winBlocksX, first,
+                                m_stageEnds[s]);
+        first = m_stageEnds[s];
+        scores.push_back(partial);
+    }
+    return scores;
+}
+
+void SoftCascade::calibrate(const QVector<QVector<double> > &positives,
+                            double bound, double tolerance)
+{
+    /* Positives the full scorer misses do not count for recall. The ones
+       it finds may be rejected early at most 'tolerance' of the time, the
+       budget is spread evenly over the stages.
+    */
+    if (isEmpty())
+        return;
+    QVector<const double *> found;
+    for (int i = 0; i < positives.size(); ++i)
+    {
+        if (positives[i].size() == m_stageEnds.size() && positives[i].last() > bound)
+        {
+            found.push_back(positives[i].constData());
+        }
+    }
+
+    const int stages = m_thresholds.size();
+    const int budget = int(qMax(0.0, tolerance) * found.size());
+    int rejected = 0;
+    for (int s = 0; s < stages; ++s)
+    {
+        QVector<double> sorted;
+        for (int i = 0; i < found.size(); ++i)
+        {
+            sorted.push_back(found[i][s]);
+        }
+        if (sorted.isEmpty())
+        {
+            m_thresholds[s] = -std::numeric_limits<double>::max();
+            continue;
+        }
+        qSort(sorted);
+        // Windows strictly below sorted[r] are rejected, at most r of them
+        int r = qMin(budget * (s + 1) / stages - rejected, sorted.size() - 1);
+        m_thresholds[s] = sorted[r];
+
+        QVector<const double *> survivors;
+        for (int i = 0; i < found.size(); ++i)
+        {
+            if (found[i][s] < m_thresholds[s])
+            {
+                ++rejected;
+                continue;
+            }
+            survivors.push_back(found[i]);
+        }
+        found = survivors;
+    }
+}
+
+void SoftCascade::clear()
+{
+    m_blockLength = 0;
+    m_winBlocksX = 0;
+    m_blockX.clear();
+    m_blockY.clear();
+    m_weights.clear();
+    m_stageEnds.clear();
+    m_thresholds.clear();
+}
+
+bool SoftCascade::isEmpty() const
+{
+    return m_stageEnds.isEmpty();
+}
+
+int SoftCascade::stages() const
+{
+    return m_stageEnds.size();
+}
+
+bool SoftCascade::scoreWindow(const HogFeature *plane, int cols, int shift,
+                              double *score, int *stage) const
+{
+    const HogFeature *window = plane + shift * m_blockLength;
+    double partial = 0;
+    int first = 0;
+    for (int s = 0; s < m_thresholds.size(); ++s)
+    {
+        partial += partialScore(window, cols, first, m_stageEnds[s]);
+        first = m_stageEnds[s];
+        if (partial < m_thresholds[s])
+        {
+            *score = partial;
+            *stage = s;
+            return false;
+        }
+    }
+    *score = partial + partialScore(window, cols, first, m_stageEnds.last());
+    *stage = m_stageEnds.size();
+    return true;
+}
+
+double SoftCascade::partialScore(const HogFeature *window, int stride,
+                                 int first, int last) const
+{
+    // Blocks [first, last) of the scoring order, 'stride' blocks per row
+    double score = 0;
+    for (int i = first; i < last; ++i)
+    {
+        const HogFeature *block = window +
+                (m_blockY[i] * stride + m_blockX[i]) * m_blockLength;
+        const HogFeature *w = m_weights.constData() + i * m_blockLength;
+        HogFeature blockScore = 0;
+        for (int k = 0; k < m_blockLength; ++k)
+        {
+            blockScore += w[k] * block[k];
+        }
+        score += blockScore;
+    }
+    return score;
+}
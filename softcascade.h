@@ -0,0 +1,58 @@
+#ifndef SOFTCASCADE_H
+#define SOFTCASCADE_H
+
+#include <QVector>
+#include "hogcore.h"
+
+/* Early rejection of linear window scores.
+
+   The window score is a sum of per-block dot products. build() orders the
+   blocks by the norm of their weights and splits the order into stages of
+   1, 2, 4, ... blocks. scoreWindow() accumulates the score in that order
+   and gives up on a window as soon as its partial score after a stage
+   falls below the stage threshold. calibrate() sets the thresholds from
+   the stage scores of positive windows, so that at most a 'tolerance'
+   fraction of the positives the full scorer accepts is rejected early.
+   The stage scores of the positives are taken once, after training, and
+   kept with the model, so calibrating needs no training images.
+*/
+class SoftCascade
+{
+public:
+    SoftCascade();
+
+    void build(const HogFeature *w, int winBlocksX, int winBlocksY,
+               int blockLength);
+    // Score of a window descriptor after every stage, the last one is its
+    // full score
+    QVector<double> stageScores(const QVector<HogFeature> &descriptor) const;
+    // 'positives' holds the stage scores of the positive windows
+    void calibrate(const QVector<QVector<double> > &positives, double bound,
+                   double tolerance);
+    void clear();
+    bool isEmpty() const;
+    int stages() const;
+
+    // Plane layout as in DetectorEngine::computeBlockPlane(). Returns false if the
+    // window was rejected, 'stage' is then the rejecting stage, otherwise
+    // 'score' holds the full score and 'stage' equals stages().
+    bool scoreWindow(const HogFeature *plane, int cols, int shift,
+                     double *score, int *stage) const;
+
+private:
+    double partialScore(const HogFeature *window, int stride,
+                        int first, int last) const;
+
+    int m_blockLength;
+    int m_winBlocksX;
+    // Window-relative block coordinates in scoring order
+    QVector<int> m_blockX;
+    QVector<int> m_blockY;
+    // Weights regrouped in scoring order
+    QVector<HogFeature> m_weights;
+    // Number of ordered blocks summed after each stage
+    QVector<int> m_stageEnds;
+    QVector<double> m_thresholds;
+};
+
+#endif // SOFTCASCADE_H
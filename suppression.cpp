@@ -0,0 +1,150 @@
+#include "suppression.h"
+#include <QtAlgorithms>
+
+namespace
+{
+
+qint64 area(const QRect &box)
+{
+    return box.isEmpty() ? 0 : qint64(box.width()) * box.height();
+}
+
+// Resizes a vector that is reused between calls. Reserved vectors keep
+// their memory when they shrink, so it is only reallocated to grow.
+template <typename T>
+void reuse(QVector<T> &vector, int size)
+{
+    if (vector.capacity() < size)
+    {
+        vector.reserve(size);
+    }
+    vector.resize(size);
+}
+
+} // namespace
+
+QVector<int> Suppression::suppressColumns(const QVector<double> &scores,
+                                          int radius)
+{
+    ColumnWorkspace workspace;
+    QVector<int> kept;
+    suppressColumns(scores, radius, workspace, kept);
+    return kept;
+}
+
+void Suppression::suppressColumns(const QVector<double> &scores, int radius,
+                                  ColumnWorkspace &workspace,
+                                  QVector<int> &kept)
+{
+    QVector<Ranked> &order = workspace.order;
+    int positive = 0;
+    for (int i = 0; i < scores.size(); ++i)
+    {
+        positive += scores[i] > 0;
+    }
+    reuse(order, positive);
+    for (int i = 0, j = 0; i < scores.size(); ++i)
+    {
+        if (scores[i] > 0)
+        {
+            order[j].score = scores[i];
+            order[j].index = i;
+            ++j;
+        }
+    }
+    qSort(order);
+
+    QVector<bool> &suppressed = workspace.suppressed;
+    reuse(suppressed, scores.size());
+    suppressed.fill(false);
+    reuse(kept, order.size());
+    int count = 0;
+    for (int i = 0; i < order.size(); ++i)
+    {
+        const int column = order[i].index;
+        if (suppressed[column])
+            continue;
+        kept[count++] = column;
+        for (int j = qMax(column - radius, 0);
+             j < qMin(column + radius + 1, scores.size()); ++j)
+        {
+            suppressed[j] = true;
+        }
+    }
+    kept.resize(count);
+}
+
+QVector<Detection> Suppression::suppressBoxes(const QVector<Detection> &candidates,
+                                              double overlap)
+{
+    QVector<Detection> kept;
+    if (candidates.isEmpty())
+        return kept;
+
+    QVector<Ranked> order(candidates.size());
+    int left = candidates[0].box.left();
+    int top = candidates[0].box.top();
+    int right = candidates[0].box.right();
+    int bottom = candidates[0].box.bottom();
+    int gridStep = 1;
+    for (int i = 0; i < candidates.size(); ++i)
+    {
+        const QRect &box = candidates[i].box;
+        order[i].score = candidates[i].score;
+        order[i].index = i;
+        left = qMin(left, box.left());
+        top = qMin(top, box.top());
+        right = qMax(right, box.right());
+        bottom = qMax(bottom, box.bottom());
+        gridStep = qMax(gridStep, qMax(box.width(), box.height()));
+    }
+    qSort(order);
+
+    // Grid cells are as large as the largest box, so a box is registered
+    // in at most 2 x 2 of them
+    const int gridCols = (right - left) / gridStep + 1;
+    const int gridRows = (bottom - top) / gridStep + 1;
+    QVector<QVector<int> > grid(gridCols * gridRows);
+    for (int i = 0; i < order.size(); ++i)
+    {
+        const Detection &candidate = candidates[order[i].index];
+        const QRect &box = candidate.box;
+        const int firstCol = (box.left() - left) / gridStep;
+        const int lastCol = (box.right() - left) / gridStep;
+        const int firstRow = (box.top() - top) / gridStep;
+        const int lastRow = (box.bottom() - top) / gridStep;
+
+        bool suppressed = false;
+        for (int y = firstRow; y <= lastRow && !suppressed; ++y)
+        {
+            for (int x = firstCol; x <= lastCol && !suppressed; ++x)
+            {
+                const QVector<int> &near = grid[y * gridCols + x];
+                for (int j = 0; j < near.size() && !suppressed; ++j)
+                {
+                    suppressed = intersectionOverUnion(box, kept[near[j]].box) > overlap;
+                }
+            }
+        }
+        if (suppressed)
+            continue;
+
+        for (int y = firstRow; y <= lastRow; ++y)
+        {
+            for (int x = firstCol; x <= lastCol; ++x)
+            {
+                grid[y * gridCols + x].push_back(kept.size());
+            }
+        }
+        kept.push_back(candidate);
+    }
+    return kept;
+}
+
+double Suppression::intersectionOverUnion(const QRect &first,
+                                          const QRect &second)
+{
+    qint64 common = area(first.intersected(second));
+    qint64 total = area(first) + area(second) - common;
+    return total > 0 ? double(common) / total : 0.0;
+}
@@ -0,0 +1,53 @@
+#ifndef SUPPRESSION_H
+#define SUPPRESSION_H
+
+#include <QVector>
+#include "detection.h"
+
+/* Greedy non-maximum suppression.
+
+   Candidates are sorted by score once and visited best first; a candidate
+   is kept unless it overlaps one kept before it. Equal scores are visited
+   in input order, so the result is the same as repeatedly picking the
+   first maximum of what is left.
+*/
+namespace Suppression
+{
+    // Score and position of a candidate; orders best first, then by index
+    struct Ranked
+    {
+        double score;
+        int index;
+
+        bool operator<(const Ranked &other) const
+        {
+            return score > other.score || (score == other.score && index < other.index);
+        }
+    };
+
+    // Scratch of suppressColumns(), its memory is kept between calls
+    struct ColumnWorkspace
+    {
+        QVector<Ranked> order;
+        QVector<bool> suppressed;
+    };
+
+    // Indices of the positive scores kept when every kept column drops
+    // the columns within 'radius' of it, best first
+    QVector<int> suppressColumns(const QVector<double> &scores, int radius);
+    // Same, into 'kept'; allocates nothing once 'workspace' and 'kept' have
+    // held as many columns
+    void suppressColumns(const QVector<double> &scores, int radius,
+                         ColumnWorkspace &workspace, QVector<int> &kept);
+
+    // Boxes kept when a kept box drops every box whose intersection over
+    // union with it exceeds 'overlap', best first. Kept boxes are looked
+    // up through a uniform grid, so each candidate is only compared with
+    // the kept boxes near it.
+    QVector<Detection> suppressBoxes(const QVector<Detection> &candidates,
+                                     double overlap);
+
+    double intersectionOverUnion(const QRect &first, const QRect &second);
+}
+
+#endif // SUPPRESSION_H
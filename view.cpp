@@ -22,6 +22,7 @@ View::View(QWidget *parent): QWidget(parent), ui(new Ui::View)
     m_precision = 0.0;
     m_recall = 0.0;
     m_fScore = 0.0;
+    setViewBusy(false);
     //statusBar()->showMessage("Ready.");
 }
 
@@ -35,16 +36,22 @@ View::~View()
 void View::setViewPrecision(double value)
 {
     m_precision = value;
+    ui->precisionValue->setEnabled(true);
+    ui->precisionValue->setText(QString::number(m_precision));
 }
 
 void View::setViewRecall(double value)
 {
     m_recall = value;
+    ui->recallValue->setEnabled(true);
+    ui->recallValue->setText(QString::number(m_recall));
 }
 
 void View::setViewFScore(double value)
 {
     m_fScore = value;
+    ui->fScoreValue->setEnabled(true);
+    ui->fScoreValue->setText(QString::number(m_fScore));
 }
 
 void View::setViewScannedImage(const QImage &image)
@@ -59,6 +66,34 @@ void View::showWarning(const QString &warningMsg)
     warningDialog->show();
 }
 
+void View::setViewProgress(const Progress &progress)
+{
+    QString text = progress.operation;
+    if (progress.rounds)
+        text += QString(", round %1/%2").arg(progress.round).arg(progress.rounds);
+    text += QString(": %1 images/s").arg(progress.imagesPerSecond, 0, 'f', 1);
+    if (progress.windowsPerSecond > 0.0)
+        text += QString(", %1 windows/s").arg(progress.windowsPerSecond, 0, 'f', 0);
+    if (progress.etaMsecs >= 0)
+    {
+        const qint64 seconds = (progress.etaMsecs + 999) / 1000;
+        text += QString(", %1:%2 left").arg(seconds / 60)
+                .arg(seconds % 60, 2, 10, QChar('0'));
+    }
+
+    ui->progressBar->setMaximum(qMax(progress.total, 1));
+    ui->progressBar->setValue(progress.done);
+    ui->progressBar->setFormat(text);
+}
+
+void View::setViewBusy(bool busy)
+{
+    ui->cancelButton->setEnabled(busy);
+    ui->progressBar->setMaximum(1);
+    ui->progressBar->setValue(0);
+    ui->progressBar->setFormat(busy ? "Working..." : "Ready");
+}
+
 void View::chooseDirButton()
 {
     QString dirName = QFileDialog::getExistingDirectory(this, tr("Choose directory"), QDir::currentPath());
@@ -155,14 +190,8 @@ void View::estimateQualityButton()
         setUserLocationFileName(ui->predLocLineEdit->text());
         setBound(ui->boundBox->value());
 
+        // The values come back through setViewPrecision() and the others
         estimateQuality();
-
-        ui->precisionValue->setEnabled(true);
-        ui->precisionValue->setText(QString::number(m_precision));
-        ui->recallValue->setEnabled(true);
-        ui->recallValue->setText(QString::number(m_recall));
-        ui->fScoreValue->setEnabled(true);
-        ui->fScoreValue->setText(QString::number(m_fScore));
     }
 }
 
@@ -180,3 +209,8 @@ void View::scanImageButton()
         scanImage(ui->imageForScanLineEdit->text());
     }
 }
+
+void View::cancelButton()
+{
+    cancel();
+}
@@ -26,6 +26,8 @@ public:
     void setViewFScore(double value);
     void setViewScannedImage(const QImage &image);
     void showWarning(const QString &warningMsg);
+    void setViewProgress(const Progress &progress);
+    void setViewBusy(bool busy);
 
 signals:
     void setTrueLocationFileName(const QString &fileName);
@@ -42,6 +44,7 @@ signals:
     void classifyDirectory();
     void estimateQuality();
     void scanImage(const QString &fileName);
+    void cancel();
 
 private slots:
     void chooseDirButton();
@@ -54,6 +57,7 @@ private slots:
     void classifyDirectoryButton();
     void estimateQualityButton();
     void scanImageButton();
+    void cancelButton();
 
 private:
     Ui::View *ui;
@@ -0,0 +1,120 @@
+#include "workstealingpool.h"
+#include <QThread>
+#include <QVector>
+
+class WorkStealingPool::Thread : public QThread
+{
+public:
+    Thread(WorkStealingPool *pool, int worker)
+        : m_pool(pool), m_worker(worker)
+    {
+    }
+
+protected:
+    void run()
+    {
+        m_pool->work(m_worker);
+    }
+
+private:
+    WorkStealingPool *m_pool;
+    int m_worker;
+};
+
+WorkStealingPool::WorkStealingPool(int workers)
+    : m_workers(workers > 0 ? workers : qMax(QThread::idealThreadCount(), 1)),
+      m_queues(new Queue[m_workers]),
+      m_job(NULL),
+      m_count(0),
+      m_chunk(1),
+      m_steals(0)
+{
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    delete[] m_queues;
+}
+
+int WorkStealingPool::workers() const
+{
+    return m_workers;
+}
+
+int WorkStealingPool::steals() const
+{
+    return m_steals;
+}
+
+void WorkStealingPool::run(Job &job, int count, int chunk)
+{
+    m_job = &job;
+    m_count = qMax(count, 0);
+    m_chunk = qMax(chunk, 1);
+    m_steals = 0;
+    const int chunks = (m_count + m_chunk - 1) / m_chunk;
+    for (int w = 0; w < m_workers; ++w)
+    {
+        m_queues[w].head = 0;
+        m_queues[w].tail = chunks > w ? (chunks - w - 1) / m_workers + 1 : 0;
+    }
+
+    // Threads are started per run, the work of a run dwarfs their cost
+    QVector<Thread *> threads;
+    for (int w = 1; w < qMin(m_workers, chunks); ++w)
+    {
+        threads.push_back(new Thread(this, w));
+        threads.last()->start();
+    }
+    work(0);
+    for (int i = 0; i < threads.size(); ++i)
+    {
+        threads[i]->wait();
+        delete threads[i];
+    }
+    m_job = NULL;
+}
+
+void WorkStealingPool::work(int worker)
+{
+    int chunk = 0;
+    while (take(worker, &chunk))
+    {
+        const int first = chunk * m_chunk;
+        const int last = qMin(first + m_chunk, m_count);
+        for (int i = first; i < last; ++i)
+        {
+            m_job->run(i, worker);
+        }
+    }
+}
+
+bool WorkStealingPool::take(int worker, int *chunk)
+{
+    {
+        Queue &own = m_queues[worker];
+        QMutexLocker locker(&own.mutex);
+        if (own.head < own.tail)
+        {
+            *chunk = worker + own.head++ * m_workers;
+            return true;
+        }
+    }
+
+    // Queues never refill, so one pass over the others finds any work left
+    for (int i = 1; i < m_workers; ++i)
+    {
+        const int victim = (worker + i) % m_workers;
+        Queue &queue = m_queues[victim];
+        QMutexLocker locker(&queue.mutex);
+        if (queue.head < queue.tail)
+        {
+            *chunk = victim + --queue.tail * m_workers;
+            locker.unlock();
+            QMutexLocker stealsLocker(&m_stealsMutex);
+            ++m_steals;
+            return true;
+        }
+    }
+    return false;
+}
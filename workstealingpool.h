@@ -0,0 +1,58 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <QMutex>
+
+/* Runs a job over a range of indices on a fixed number of threads.
+
+   The range is cut into chunks, dealt round-robin to per-worker queues.
+   A worker takes chunks from the front of its own queue, lowest indices
+   first, and when that is empty steals from the back of another one, so
+   a worker stuck on slow items does not hold up the rest while indices
+   are still finished roughly in order. The calling thread is worker 0.
+*/
+class WorkStealingPool
+{
+public:
+    class Job
+    {
+    public:
+        virtual ~Job() {}
+        // Called once for every index, by worker 'worker' < workers()
+        virtual void run(int index, int worker) = 0;
+    };
+
+    // 0 workers means one per core
+    explicit WorkStealingPool(int workers = 0);
+    ~WorkStealingPool();
+
+    int workers() const;
+    // Calls job.run() for every index in [0, count) and returns when all
+    // calls have returned
+    void run(Job &job, int count, int chunk = 1);
+    // Chunks taken from another worker's queue during the last run()
+    int steals() const;
+
+private:
+    class Thread;
+    // Chunks worker + i * workers() for head <= i < tail
+    struct Queue
+    {
+        QMutex mutex;
+        int head;
+        int tail;
+    };
+
+    void work(int worker);
+    bool take(int worker, int *chunk);
+
+    int m_workers;
+    Queue *m_queues;
+    Job *m_job;
+    int m_count;
+    int m_chunk;
+    int m_steals;
+    QMutex m_stealsMutex;
+};
+
+#endif // WORKSTEALINGPOOL_H